@@ -0,0 +1,183 @@
+#ifndef __Arena_h
+#define __Arena_h
+#include "Object.h"
+#include "Stats.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+// Block-based bump allocator. Objects placed in an arena are never
+// destroyed one by one: the whole arena is rewound by reset(), which
+// keeps its blocks for the next document, or freed when released.
+class Arena: public Object
+{
+public:
+  // Constructor
+  Arena(size_t blockSize = 64 * 1024):
+    blockSize(blockSize),
+    first(0),
+    current(0),
+    top(0),
+    limit(0),
+    adopted(0),
+    numberOfBlocks(0)
+  {
+    // do nothing
+  }
+
+  // Destructor
+  ~Arena();
+
+  void* allocate(size_t, size_t = __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  void reset();
+
+  // Keep another arena, and everything placed in it, alive for as long
+  // as this one; used when parts of one tree were built in separate
+  // arenas
+  void adopt(Arena*);
+
+  // Number of blocks obtained from the system allocator
+  int getNumberOfBlocks() const
+  {
+    return numberOfBlocks;
+  }
+
+private:
+  struct Block
+  {
+    Block* next;
+    size_t size;
+  };
+
+  struct Adopted
+  {
+    Arena* arena;
+    Adopted* next;
+  };
+
+  size_t blockSize; // size of a regular block
+  Block* first; // first block
+  Block* current; // block being filled
+  char* top; // next free byte of the current block
+  char* limit; // end of the current block
+  Adopted* adopted; // arenas kept alive by this one
+
+  int numberOfBlocks;
+
+  char* begin(Block* b) const
+  {
+    return (char*)(b + 1);
+  }
+
+  void* grow(size_t, size_t);
+  void releaseAdopted();
+
+  Arena(const Arena&);
+  Arena& operator =(const Arena&);
+
+}; // Arena
+
+typedef ObjectPtr<Arena> ArenaPtr;
+
+Arena::~Arena()
+{
+  releaseAdopted();
+  while (first != 0)
+  {
+    Block* temp = first;
+
+    first = first->next;
+    free(temp);
+  }
+}
+
+inline void*
+Arena::allocate(size_t size, size_t alignment)
+{
+  char* p = (char*)(((size_t)top + alignment - 1) & ~(alignment - 1));
+
+  if (p + size > limit || top == 0)
+    return grow(size, alignment);
+  top = p + size;
+  Stats::allocate(size);
+  return p;
+}
+
+// Move to the next block that can hold size bytes, reusing the blocks
+// kept by reset() before asking the system for a new one
+void*
+Arena::grow(size_t size, size_t alignment)
+{
+  size_t need = size + alignment;
+
+  if (current != 0)
+    while (current->next != 0 && current->next->size < need)
+      current = current->next;
+
+  Block* b = current == 0 ? first : current->next;
+
+  if (b == 0 || b->size < need)
+  {
+    size_t n = need > blockSize ? need : blockSize;
+
+    b = (Block*)malloc(sizeof(Block) + n);
+    if (b == 0)
+      throw std::bad_alloc();
+    b->size = n;
+    numberOfBlocks++;
+    if (current == 0)
+    {
+      b->next = first;
+      first = b;
+    }
+    else
+    {
+      b->next = current->next;
+      current->next = b;
+    }
+  }
+  current = b;
+  top = begin(b);
+  limit = top + b->size;
+  return allocate(size, alignment);
+}
+
+void
+Arena::reset()
+{
+  releaseAdopted();
+  current = 0;
+  top = limit = 0;
+}
+
+void
+Arena::adopt(Arena* arena)
+{
+  Adopted* a = new (allocate(sizeof(Adopted))) Adopted;
+
+  a->arena = makeUse(arena);
+  a->next = adopted;
+  adopted = a;
+}
+
+// The list lives in this arena's blocks, so it goes before they do
+void
+Arena::releaseAdopted()
+{
+  for (; adopted != 0; adopted = adopted->next)
+    adopted->arena->release();
+}
+
+inline void*
+operator new(size_t size, Arena& arena)
+{
+  return arena.allocate(size);
+}
+
+inline void
+operator delete(void*, Arena&)
+{
+  // do nothing
+}
+
+#endif // __Arena_h
@@ -0,0 +1,64 @@
+#ifndef __CharClass_h
+#define __CharClass_h
+#include <stdint.h>
+
+/*
+Character classes
+=================
+The questions the lexers ask of nearly every byte, answered by one
+256-entry table built at compile time: a load and an AND instead of
+the calls of <ctype.h>, which depend on the locale and whose behaviour
+is undefined for the negative chars of UTF-8 text. A delimiter is a
+byte that may end a number or a literal: whitespace or one of
+{ } [ ] : ,
+*/
+
+class CharClass
+{
+public:
+  enum
+  {
+    DIGIT = 1,
+    WHITESPACE = 2,
+    DELIMITER = 4
+  };
+
+  static bool isDigit(char c)
+  {
+    return (table.classes[(unsigned char)c] & DIGIT) != 0;
+  }
+
+  static bool isWhitespace(char c)
+  {
+    return (table.classes[(unsigned char)c] & WHITESPACE) != 0;
+  }
+
+  static bool isDelimiter(char c)
+  {
+    return (table.classes[(unsigned char)c] & DELIMITER) != 0;
+  }
+
+private:
+  struct Table
+  {
+    uint8_t classes[256];
+
+    constexpr Table():
+      classes()
+    {
+      for (int c = '0'; c <= '9'; c++)
+        classes[c] = DIGIT;
+      classes[' '] = classes['\t'] = classes['\n'] = classes['\r'] =
+        WHITESPACE | DELIMITER;
+      classes['{'] = classes['}'] = classes['['] = classes[']'] =
+        classes[':'] = classes[','] = DELIMITER;
+    }
+  };
+
+  static const Table table;
+
+}; // CharClass
+
+inline constexpr CharClass::Table CharClass::table = CharClass::Table();
+
+#endif // __CharClass_h
@@ -0,0 +1,73 @@
+#ifndef __Counter_h
+#define __Counter_h
+#include "Lexer.h"
+
+// Handler that only counts what the reader finds
+class Counter
+{
+public:
+  int objetos;
+  int membros;
+  int arrays;
+  int elementos;
+
+  Counter()
+  {
+    objetos = 0;
+    membros = 0;
+    arrays = 0;
+    elementos = 0;
+  }
+
+  bool startObject()
+  {
+    objetos++;
+    return true;
+  }
+
+  bool key(string_view)
+  {
+    return true;
+  }
+
+  bool endObject(int n)
+  {
+    membros += n;
+    return true;
+  }
+
+  bool startArray()
+  {
+    arrays++;
+    return true;
+  }
+
+  bool endArray(int n)
+  {
+    elementos += n;
+    return true;
+  }
+
+  bool string(string_view)
+  {
+    return true;
+  }
+
+  bool number(string_view)
+  {
+    return true;
+  }
+
+  bool boolean(bool)
+  {
+    return true;
+  }
+
+  bool null()
+  {
+    return true;
+  }
+
+}; // Counter
+
+#endif // __Counter_h
@@ -0,0 +1,95 @@
+#ifndef __Cpu_h
+#define __Cpu_h
+#include <stdlib.h>
+#include <string.h>
+
+/*
+Processor features
+==================
+The vector kernels (the classifier of Structural.h, the UTF-8 check of
+Utf8.h and the string scan of Escape.h) are compiled for each set of
+instructions an x86 processor may have, whatever the compiler options,
+and the program runs on any of them: the best set the processor and
+the operating system support is chosen once, when the program starts,
+and every kernel is called through that choice.
+
+The environment variable JSON_SIMD, set to scalar, sse4.2 or avx2,
+overrides the choice, to test or time every kernel on one machine. A
+set the processor lacks is lowered to the best one it has; any other
+value is ignored. Every kernel gives the same results.
+
+On other processors, or with other compilers, only the scalar kernels
+are compiled.
+*/
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CPU_X86
+#include <immintrin.h>
+// A kernel compiled for a set of instructions
+#define CPU_SSE42 __attribute__((target("sse4.2")))
+#define CPU_AVX2 __attribute__((target("avx2,pclmul")))
+// A function that runs a kernel, with everything it calls inlined into
+// it, so that the kernel is inlined too and compiled in its loop
+#define CPU_DISPATCH __attribute__((flatten))
+#endif
+
+class Cpu
+{
+public:
+  enum Level
+  {
+    SCALAR,
+    SSE42,
+    AVX2,
+    NUMBER_OF_LEVELS
+  }; // Level
+
+  // The kernels in use. It is SCALAR, the zero of a static, until the
+  // program starts, so a kernel called earlier is still a correct one.
+  static const Level level;
+
+  // Best level the processor supports
+  static Level detect();
+
+  static const char* getName(int level)
+  {
+    static const char* const names[] = {"scalar", "sse4.2", "avx2"};
+
+    return names[level];
+  }
+
+private:
+  static Level choose();
+
+}; // Cpu
+
+const Cpu::Level Cpu::level = Cpu::choose();
+
+Cpu::Level
+Cpu::detect()
+{
+#ifdef CPU_X86
+  // cpuid, and xgetbv for the registers the system saves
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul"))
+    return AVX2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return SSE42;
+#endif
+  return SCALAR;
+}
+
+Cpu::Level
+Cpu::choose()
+{
+  Level best = detect();
+  const char* wanted = getenv("JSON_SIMD");
+
+  if (wanted != 0)
+    for (int i = SCALAR; i <= best; i++)
+      if (strcmp(wanted, getName(i)) == 0)
+        return (Level)i;
+  return best;
+}
+
+#endif // __Cpu_h
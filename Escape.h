@@ -0,0 +1,460 @@
+#ifndef __Escape_h
+#define __Escape_h
+#include "Cpu.h"
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+
+/*
+Strings
+=======
+The contents of a JSON string are checked by scan() a block of 16 or 32
+bytes at a time: one comparison each for the quote, the backslash and
+the control characters, and the block is skipped whole when none of
+them is found, which is the usual case in long strings such as log
+messages or base64 data. Only escapes are looked at byte by byte:
+
+  \"  \\  \/  \b  \f  \n  \r  \t  \uXXXX
+
+where a \u escape of a high surrogate must be followed by one of a low
+surrogate, and a low surrogate cannot stand alone.
+
+unescape() decodes checked contents to UTF-8, copying the text between
+escapes in one move. The decoded text is never longer than the escaped
+one, so it may be written over the contents themselves when the input
+buffer is writable.
+
+escape() goes the other way with the same block scan: the runs without
+a quote, a backslash or a control character are copied whole, and only
+those characters are escaped, with the short forms where there is one.
+
+The block scan is a kernel of Cpu.h. scan() and escape() are compiled
+whole for each level, with the kernel inlined into their loops, and
+pick the one in use once per string rather than once per block.
+*/
+
+class Escape
+{
+public:
+  // Check the contents of a string, from p just after the opening quote
+  // to end at the latest. Returns true with p on the closing quote, or
+  // false with p on the first byte that cannot be in a string.
+  static bool scan(const char*& p, const char* end);
+
+  // Decode the contents s into out, which has room for s.size() bytes
+  // and may be s.data() itself. Returns the decoded size, or -1 if s has
+  // an escape scan() would not accept.
+  static long unescape(std::string_view s, char* out);
+  static bool unescape(std::string_view, std::string&);
+
+  // Write text escaped as the contents of a string to out, which has
+  // write(const char*, size_t)
+  template <typename Output> static void escape(std::string_view, Output&);
+
+private:
+  // The block scans: first quote, backslash or control character from
+  // p, or end
+  struct Scalar
+  {
+    static const char* special(const char* p, const char* end);
+  };
+#ifdef CPU_X86
+  struct Sse42
+  {
+    CPU_SSE42 static const char* special(const char* p, const char* end);
+  };
+  struct Avx2
+  {
+    CPU_AVX2 static const char* special(const char* p, const char* end);
+  };
+
+  CPU_SSE42 CPU_DISPATCH static bool scanSse42(const char*&, const char*);
+  CPU_AVX2 CPU_DISPATCH static bool scanAvx2(const char*&, const char*);
+  template <typename Output>
+  CPU_SSE42 CPU_DISPATCH static void escapeSse42(std::string_view, Output&);
+  template <typename Output>
+  CPU_AVX2 CPU_DISPATCH static void escapeAvx2(std::string_view, Output&);
+#endif
+
+  template <typename Kernel> static bool scan(const char*&, const char*);
+  template <typename Kernel, typename Output>
+  static void escape(std::string_view, Output&);
+  static int hex(const char*, const char*, uint32_t&);
+  static bool unicode(const char*&, const char*);
+  static char* utf8(uint32_t, char*);
+
+}; // Escape
+
+// Number of hex digits, up to 4, at p; code is their value
+inline int
+Escape::hex(const char* p, const char* end, uint32_t& code)
+{
+  int n = 0;
+
+  code = 0;
+  for (; n < 4 && p + n < end; n++)
+  {
+    char c = p[n];
+
+    if (c >= '0' && c <= '9')
+      code = code << 4 | (c - '0');
+    else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+      code = code << 4 | ((c | 0x20) - 'a' + 10);
+    else
+      break;
+  }
+  return n;
+}
+
+// Check a \u escape with p on its 'u', and the low surrogate after it
+// if it is a high surrogate. Leaves p after them, or on the error.
+bool
+Escape::unicode(const char*& p, const char* end)
+{
+  uint32_t code;
+  int n = hex(++p, end, code);
+
+  p += n;
+  if (n < 4)
+    return false;
+  if (code >= 0xdc00 && code <= 0xdfff)
+  {
+    p -= 6;
+    return false;
+  }
+  if (code < 0xd800 || code > 0xdbff)
+    return true;
+  if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+    return false;
+  n = hex(p + 2, end, code);
+  if (n < 4)
+  {
+    p += 2 + n;
+    return false;
+  }
+  if (code < 0xdc00 || code > 0xdfff)
+    return false;
+  p += 6;
+  return true;
+}
+
+inline const char*
+Escape::Scalar::special(const char* p, const char* end)
+{
+  while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+    ++p;
+  return p;
+}
+
+#ifdef CPU_X86
+
+inline const char*
+Escape::Sse42::special(const char* p, const char* end)
+{
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1f);
+
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i found = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+      _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+    uint32_t mask = _mm_movemask_epi8(found);
+
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+  }
+  return Scalar::special(p, end);
+}
+
+inline const char*
+Escape::Avx2::special(const char* p, const char* end)
+{
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i control = _mm256_set1_epi8(0x1f);
+
+  for (; end - p >= 32; p += 32)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    __m256i found = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+    uint32_t mask = _mm256_movemask_epi8(found);
+
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+  }
+  return Scalar::special(p, end);
+}
+
+bool
+Escape::scanSse42(const char*& p, const char* end)
+{
+  return scan<Sse42>(p, end);
+}
+
+bool
+Escape::scanAvx2(const char*& p, const char* end)
+{
+  return scan<Avx2>(p, end);
+}
+
+#endif
+
+inline bool
+Escape::scan(const char*& p, const char* end)
+{
+#ifdef CPU_X86
+  switch (Cpu::level)
+  {
+    case Cpu::AVX2:
+      return scanAvx2(p, end);
+    case Cpu::SSE42:
+      return scanSse42(p, end);
+    default:
+      break;
+  }
+#endif
+  return scan<Scalar>(p, end);
+}
+
+template <typename Kernel>
+inline bool
+Escape::scan(const char*& p, const char* end)
+{
+  for (;;)
+  {
+    p = Kernel::special(p, end);
+    if (p == end || *p != '\\')
+      return p < end && *p == '"';
+    if (++p == end)
+      return false;
+    switch (*p)
+    {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        ++p;
+        break;
+      case 'u':
+        if (!unicode(p, end))
+          return false;
+        break;
+      default:
+        return false;
+    }
+  }
+}
+
+// Write code point c as UTF-8 at out; returns the end of what was written
+inline char*
+Escape::utf8(uint32_t c, char* out)
+{
+  if (c < 0x80)
+    *out++ = c;
+  else if (c < 0x800)
+  {
+    *out++ = 0xc0 | c >> 6;
+    *out++ = 0x80 | (c & 0x3f);
+  }
+  else if (c < 0x10000)
+  {
+    *out++ = 0xe0 | c >> 12;
+    *out++ = 0x80 | (c >> 6 & 0x3f);
+    *out++ = 0x80 | (c & 0x3f);
+  }
+  else
+  {
+    *out++ = 0xf0 | c >> 18;
+    *out++ = 0x80 | (c >> 12 & 0x3f);
+    *out++ = 0x80 | (c >> 6 & 0x3f);
+    *out++ = 0x80 | (c & 0x3f);
+  }
+  return out;
+}
+
+long
+Escape::unescape(std::string_view s, char* out)
+{
+  const char* p = s.data();
+  const char* end = p + s.size();
+  char* q = out;
+
+  for (;;)
+  {
+    const char* b = (const char*)memchr(p, '\\', end - p);
+    size_t n = (b != 0 ? b : end) - p;
+
+    // memmove, since out may be the contents themselves
+    if (q != p)
+      memmove(q, p, n);
+    q += n;
+    if (b == 0)
+      return q - out;
+    p = b + 1;
+    if (p == end)
+      return -1;
+
+    uint32_t c;
+
+    switch (*p++)
+    {
+      case '"':
+        *q++ = '"';
+        continue;
+      case '\\':
+        *q++ = '\\';
+        continue;
+      case '/':
+        *q++ = '/';
+        continue;
+      case 'b':
+        *q++ = '\b';
+        continue;
+      case 'f':
+        *q++ = '\f';
+        continue;
+      case 'n':
+        *q++ = '\n';
+        continue;
+      case 'r':
+        *q++ = '\r';
+        continue;
+      case 't':
+        *q++ = '\t';
+        continue;
+      case 'u':
+        if (hex(p, end, c) < 4)
+          return -1;
+        p += 4;
+        break;
+      default:
+        return -1;
+    }
+    if (c >= 0xdc00 && c <= 0xdfff)
+      return -1;
+    if (c >= 0xd800 && c <= 0xdbff)
+    {
+      uint32_t low;
+
+      if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+        hex(p + 2, end, low) < 4 || low < 0xdc00 || low > 0xdfff)
+        return -1;
+      p += 6;
+      c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+    }
+    q = utf8(c, q);
+  }
+}
+
+bool
+Escape::unescape(std::string_view s, std::string& out)
+{
+  out.resize(s.size());
+
+  long n = unescape(s, &out[0]);
+
+  out.resize(n < 0 ? 0 : n);
+  return n >= 0;
+}
+
+template <typename Output>
+inline void
+Escape::escape(std::string_view s, Output& out)
+{
+#ifdef CPU_X86
+  switch (Cpu::level)
+  {
+    case Cpu::AVX2:
+      escapeAvx2(s, out);
+      return;
+    case Cpu::SSE42:
+      escapeSse42(s, out);
+      return;
+    default:
+      break;
+  }
+#endif
+  escape<Scalar>(s, out);
+}
+
+#ifdef CPU_X86
+
+template <typename Output>
+void
+Escape::escapeSse42(std::string_view s, Output& out)
+{
+  escape<Sse42>(s, out);
+}
+
+template <typename Output>
+void
+Escape::escapeAvx2(std::string_view s, Output& out)
+{
+  escape<Avx2>(s, out);
+}
+
+#endif
+
+template <typename Kernel, typename Output>
+inline void
+Escape::escape(std::string_view s, Output& out)
+{
+  static const char hex[] = "0123456789abcdef";
+  const char* p = s.data();
+  const char* end = p + s.size();
+
+  for (;;)
+  {
+    const char* q = Kernel::special(p, end);
+
+    out.write(p, q - p);
+    if (q == end)
+      return;
+
+    char c = *q;
+    char e[6] = {'\\', c, 0, 0, 0, 0};
+    size_t n = 2;
+
+    switch (c)
+    {
+      case '"':
+      case '\\':
+        break;
+      case '\b':
+        e[1] = 'b';
+        break;
+      case '\f':
+        e[1] = 'f';
+        break;
+      case '\n':
+        e[1] = 'n';
+        break;
+      case '\r':
+        e[1] = 'r';
+        break;
+      case '\t':
+        e[1] = 't';
+        break;
+      default:
+        e[1] = 'u';
+        e[2] = e[3] = '0';
+        e[4] = hex[c >> 4];
+        e[5] = hex[c & 15];
+        n = 6;
+    }
+    out.write(e, n);
+    p = q + 1;
+  }
+}
+
+#endif // __Escape_h
@@ -0,0 +1,208 @@
+#ifndef __Input_h
+#define __Input_h
+#include "Object.h"
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Text being parsed. Tokens and tree nodes refer to it by position, so
+// a document keeps its input alive for as long as the document lives.
+// The byte at data()[size()] must be readable and must be '\0'.
+class Input: public Object
+{
+public:
+  // Zero bytes readable past the end of a loaded input, so vector
+  // code may load a whole block that starts before the end
+  enum { PADDING = 64 };
+
+  // Take over the contents of text without copying them
+  Input(std::string& text):
+    mapping(0),
+    mappingSize(0),
+    heap(0)
+  {
+    this->text.swap(text);
+    chars = this->text.c_str();
+    length = this->text.size();
+  }
+
+  // Refer to a buffer owned by the caller
+  Input(const char* data, size_t size):
+    chars(data),
+    length(size),
+    mapping(0),
+    mappingSize(0),
+    heap(0)
+  {
+    // do nothing
+  }
+
+  Input(const char* data):
+    chars(data),
+    length(strlen(data)),
+    mapping(0),
+    mappingSize(0),
+    heap(0)
+  {
+    // do nothing
+  }
+
+  // Destructor
+  ~Input()
+  {
+    if (mapping != 0)
+      munmap(mapping, mappingSize);
+    free(heap);
+  }
+
+  // Load a file, or the standard input when fileName is "-". Regular
+  // files are mapped read-only; pipes and devices are read in large
+  // blocks. Returns 0 if the file cannot be read.
+  static Input* load(const char* fileName);
+
+  const char* data() const
+  {
+    return chars;
+  }
+
+  size_t size() const
+  {
+    return length;
+  }
+
+private:
+  std::string text;
+  const char* chars;
+  size_t length;
+  void* mapping; // region mapped by load()
+  size_t mappingSize;
+  char* heap; // buffer read by load()
+
+  Input():
+    chars(0),
+    length(0),
+    mapping(0),
+    mappingSize(0),
+    heap(0)
+  {
+    // do nothing
+  }
+
+  bool map(int, size_t);
+  bool read(int);
+
+  Input(const Input&);
+  Input& operator =(const Input&);
+
+}; // Input
+
+typedef ObjectPtr<Input> InputPtr;
+
+Input*
+Input::load(const char* fileName)
+{
+  bool stdIn = strcmp(fileName, "-") == 0;
+  int fd = stdIn ? 0 : open(fileName, O_RDONLY);
+
+  if (fd < 0)
+    return 0;
+
+  Input* input = new Input();
+  struct stat st;
+  bool ok;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    ok = input->map(fd, st.st_size) || input->read(fd);
+  else
+    ok = input->read(fd);
+  if (!stdIn)
+    close(fd);
+  if (!ok)
+  {
+    delete input;
+    return 0;
+  }
+  return input;
+}
+
+// Map size bytes of fd followed by zeroed padding. The padding comes
+// from an anonymous mapping reserved first and then partly covered by
+// the file, so reading it never faults even when the file ends on a
+// page boundary.
+bool
+Input::map(int fd, size_t size)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t total = (size + PADDING + page - 1) & ~(page - 1);
+  void* base = mmap(0, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (base == MAP_FAILED)
+    return false;
+  if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+  {
+    munmap(base, total);
+    return false;
+  }
+  madvise(base, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  // Only honoured by kernels with huge pages for file mappings
+  madvise(base, size, MADV_HUGEPAGE);
+#endif
+  mapping = base;
+  mappingSize = total;
+  chars = (const char*)base;
+  length = size;
+  return true;
+}
+
+// Read fd to its end in blocks that double in size
+bool
+Input::read(int fd)
+{
+  size_t capacity = 1 << 20;
+  size_t size = 0;
+  char* buffer = (char*)malloc(capacity + PADDING);
+
+  if (buffer == 0)
+    return false;
+  for (;;)
+  {
+    if (size == capacity)
+    {
+      char* temp = (char*)realloc(buffer, 2 * capacity + PADDING);
+
+      if (temp == 0)
+      {
+        free(buffer);
+        return false;
+      }
+      buffer = temp;
+      capacity *= 2;
+    }
+
+    ssize_t n = ::read(fd, buffer + size, capacity - size);
+
+    if (n == 0)
+      break;
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+    {
+      free(buffer);
+      return false;
+    }
+    size += n;
+  }
+  memset(buffer + size, 0, PADDING);
+  heap = buffer;
+  chars = buffer;
+  length = size;
+  return true;
+}
+
+#endif // __Input_h
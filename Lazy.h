@@ -0,0 +1,516 @@
+#ifndef __Lazy_h
+#define __Lazy_h
+#include "Lexer.h"
+#include "Number.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+Lazy document
+=============
+On-demand access to a document. Building one indexes the structure of
+the input once: the structural index, plus the position just after
+each '{' or '[' is closed, found with a stack while the brackets are
+checked to match. Nothing else is decoded. A LazyValue is a cursor on
+one position; a string is unescaped, a number converted, and a
+container entered only when the caller asks for it, and the siblings
+passed over on the way are skipped in one step each.
+
+Only what is visited is checked beyond its brackets: a malformed value
+the caller never touches is not reported. Errors are thrown as
+ParseError, like the parser's.
+*/
+
+class LazyValue;
+
+class LazyDocument: public Object
+{
+public:
+  // Constructors
+  LazyDocument():
+    text(0),
+    ends(0),
+    capacity(0)
+  {
+    // do nothing
+  }
+
+  LazyDocument(Input* source):
+    text(0),
+    ends(0),
+    capacity(0)
+  {
+    parse(source);
+  }
+
+  // Destructor
+  ~LazyDocument()
+  {
+    delete[] ends;
+  }
+
+  // Index input, keeping the buffers of the previous one; values of
+  // the previous input are no longer valid. Throws ParseError if the
+  // brackets do not match.
+  void parse(Input*);
+
+  LazyValue getRoot() const;
+
+private:
+  InputPtr input;
+  const char* text;
+  StructuralIndex index;
+  uint32_t* ends; // position after each container, at its position
+  size_t capacity; // room in ends
+  std::vector<uint32_t> open; // containers not yet closed
+
+  char at(uint32_t i) const
+  {
+    return text[index.begin()[i]];
+  }
+
+  const char* pointer(uint32_t i) const
+  {
+    return text + index.begin()[i];
+  }
+
+  // Position after the value at i
+  uint32_t skip(uint32_t i) const
+  {
+    return at(i) == '{' || at(i) == '[' ? ends[i] : i + 1;
+  }
+
+  void error(const char*) const;
+
+  LazyDocument(const LazyDocument&);
+  LazyDocument& operator =(const LazyDocument&);
+
+  friend class LazyValue;
+
+}; // LazyDocument
+
+typedef ObjectPtr<LazyDocument> LazyDocumentPtr;
+
+// Cursor on a value of a lazy document. Valid as long as the document.
+class LazyValue
+{
+public:
+  enum Type
+  {
+    INVALID,
+    OBJECT,
+    ARRAY,
+    STRING,
+    NUMBER,
+    BOOLEAN,
+    NULL_
+  }; // Type
+
+  LazyValue():
+    document(0),
+    position(0),
+    member(false)
+  {
+    // do nothing
+  }
+
+  bool isValid() const
+  {
+    return document != 0;
+  }
+
+  int getType() const;
+
+  bool isObject() const
+  {
+    return getType() == OBJECT;
+  }
+
+  bool isArray() const
+  {
+    return getType() == ARRAY;
+  }
+
+  bool isString() const
+  {
+    return getType() == STRING;
+  }
+
+  bool isNumber() const
+  {
+    return getType() == NUMBER;
+  }
+
+  bool isNull() const
+  {
+    return getType() == NULL_;
+  }
+
+  // Value of the first member named key, compared unescaped as by
+  // Obj::get(), or an invalid value
+  LazyValue get(std::string_view) const;
+
+  // Element i of an array, or an invalid value
+  LazyValue operator [](int) const;
+
+  // First element or member value of a container, and the one after
+  // this; invalid at the end
+  LazyValue getFirst() const;
+  LazyValue getNext() const;
+
+  // Key of a member value, escaped
+  std::string_view getKey() const;
+
+  // Number of elements or members; walks the container
+  int size() const;
+
+  // Text of the value as it is in the input: a string's contents still
+  // escaped, or a number's lexeme
+  std::string_view getRaw() const;
+
+  std::string getString() const; // unescaped, in UTF-8
+  bool getBool() const;
+  int64_t asInt64() const;
+  uint64_t asUInt64() const;
+  double asDouble() const;
+
+private:
+  const LazyDocument* document;
+  uint32_t position; // of the value in the structural index
+  bool member; // whether the value is an object member's
+
+  LazyValue(const LazyDocument* document, uint32_t position, bool member):
+    document(document),
+    position(position),
+    member(member)
+  {
+    // do nothing
+  }
+
+  LazyValue memberAt(uint32_t) const;
+  LazyValue sibling(uint32_t, char) const;
+  std::string_view scalar() const;
+  std::string_view checkedNumber(Number::Bits&, int&) const;
+
+  friend class LazyDocument;
+
+}; // LazyValue
+
+void
+LazyDocument::parse(Input* source)
+{
+  input = source;
+  text = source->data();
+  if (!index.build(text, source->size()))
+    error(text + source->size());
+
+  uint32_t n = index.size();
+
+  if (n == 0)
+    error(text + source->size());
+  if (capacity < n)
+  {
+    delete[] ends;
+    capacity = n;
+    ends = new uint32_t[capacity];
+  }
+  open.clear();
+  for (uint32_t i = 0; i < n; i++)
+    switch (at(i))
+    {
+      case '{':
+      case '[':
+        open.push_back(i);
+        break;
+      case '}':
+      case ']':
+        if (open.empty() || at(open.back()) != (at(i) == '}' ? '{' : '['))
+          error(pointer(i));
+        ends[open.back()] = i + 1;
+        open.pop_back();
+        break;
+    }
+  if (!open.empty())
+    error(pointer(open.back()));
+  if (skip(0) != n)
+    error(pointer(skip(0)));
+}
+
+inline LazyValue
+LazyDocument::getRoot() const
+{
+  return LazyValue(this, 0, false);
+}
+
+void
+LazyDocument::error(const char* p) const
+{
+  throw ParseError::at(text, p, ParseError::SYNTAX);
+}
+
+int
+LazyValue::getType() const
+{
+  if (document == 0)
+    return INVALID;
+  switch (document->at(position))
+  {
+    case '{':
+      return OBJECT;
+    case '[':
+      return ARRAY;
+    case '"':
+      return STRING;
+    case 't':
+    case 'f':
+      return BOOLEAN;
+    case 'n':
+      return NULL_;
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      return NUMBER;
+  }
+  document->error(document->pointer(position));
+  return INVALID;
+}
+
+// Member whose key is at position i: "key" ':' value
+LazyValue
+LazyValue::memberAt(uint32_t i) const
+{
+  if (document->at(i) != '"' || document->at(i + 1) != ':')
+    document->error(document->pointer(i));
+  return LazyValue(document, i + 2, true);
+}
+
+// Value after the separator at i of a container closed by close
+LazyValue
+LazyValue::sibling(uint32_t i, char close) const
+{
+  char c = document->at(i);
+
+  if (c == close)
+    return LazyValue();
+  if (c != ',')
+    document->error(document->pointer(i));
+  return close == '}' ? memberAt(i + 1) : LazyValue(document, i + 1, false);
+}
+
+LazyValue
+LazyValue::getFirst() const
+{
+  switch (getType())
+  {
+    case OBJECT:
+      if (document->at(position + 1) == '}')
+        return LazyValue();
+      return memberAt(position + 1);
+    case ARRAY:
+      if (document->at(position + 1) == ']')
+        return LazyValue();
+      return LazyValue(document, position + 1, false);
+  }
+  return LazyValue();
+}
+
+LazyValue
+LazyValue::getNext() const
+{
+  // A separator or bracket where a value should be is caught here,
+  // before anything is read past it
+  if (getType() == INVALID)
+    return LazyValue();
+  return sibling(document->skip(position), member ? '}' : ']');
+}
+
+std::string_view
+LazyValue::getKey() const
+{
+  if (!member)
+    return std::string_view();
+  return LazyValue(document, position - 2, false).getRaw();
+}
+
+LazyValue
+LazyValue::get(std::string_view key) const
+{
+  if (!isObject())
+    return LazyValue();
+
+  // Without a quote or a backslash in key, the raw key is compared in
+  // place, which stops at its closing quote at the latest: it matches
+  // if it starts with key and the quote follows, and it cannot match
+  // if it differs first at a byte that is not a backslash. Only a key
+  // with an escape at that byte, or any key against a key with a quote
+  // or a backslash, is unescaped to be compared.
+  size_t n = key.size();
+  bool direct = memchr(key.data(), '"', n) == 0 && memchr(key.data(), 92, n) == 0;
+  std::string unescaped;
+
+  for (LazyValue v = getFirst(); v.isValid(); v = v.getNext())
+  {
+    if (direct)
+    {
+      const char* p = document->pointer(v.position - 2) + 1;
+      size_t i = 0;
+
+      while (i < n && p[i] == key[i])
+        i++;
+      if (i == n && p[n] == '"')
+        return v;
+      if (p[i] != 92)
+        continue;
+    }
+    Escape::unescape(v.getKey(), unescaped);
+    if (unescaped == key)
+      return v;
+  }
+  return LazyValue();
+}
+
+LazyValue
+LazyValue::operator [](int n) const
+{
+  if (!isArray() || n < 0)
+    return LazyValue();
+
+  LazyValue v = getFirst();
+
+  while (n-- > 0 && v.isValid())
+    v = v.getNext();
+  return v;
+}
+
+int
+LazyValue::size() const
+{
+  int n = 0;
+
+  for (LazyValue v = getFirst(); v.isValid(); v = v.getNext())
+    n++;
+  return n;
+}
+
+// Text of a scalar up to the first delimiter, or the contents of a
+// string up to its closing quote
+std::string_view
+LazyValue::scalar() const
+{
+  const char* begin = document->pointer(position);
+  const char* p = begin;
+
+  if (*p == '"')
+  {
+    if (!Escape::scan(++p, document->input->data() + document->input->size()))
+      document->error(p);
+    return std::string_view(begin + 1, p - begin - 1);
+  }
+  for (;; ++p)
+    switch (*p)
+    {
+      case 0:
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        return std::string_view(begin, p - begin);
+    }
+}
+
+std::string_view
+LazyValue::getRaw() const
+{
+  return document != 0 && getType() != OBJECT && getType() != ARRAY ?
+    scalar() : std::string_view();
+}
+
+std::string
+LazyValue::getString() const
+{
+  std::string s;
+
+  if (!isString())
+    return s;
+
+  Escape::unescape(scalar(), s);
+  return s;
+}
+
+bool
+LazyValue::getBool() const
+{
+  if (getType() != BOOLEAN)
+    return false;
+
+  std::string_view s = scalar();
+
+  if (s != "true" && s != "false")
+    document->error(s.data());
+  return s[0] == 't';
+}
+
+// Lexeme of a number, checked and decoded
+std::string_view
+LazyValue::checkedNumber(Number::Bits& value, int& kind) const
+{
+  kind = Number::NONE;
+  if (!isNumber())
+    return std::string_view();
+
+  std::string_view s = scalar();
+
+  if (!Number::isValid(s))
+    document->error(s.data());
+  kind = Number::decode(s, value);
+  return s;
+}
+
+int64_t
+LazyValue::asInt64() const
+{
+  Number::Bits value;
+  int kind;
+
+  checkedNumber(value, kind);
+  return kind == Number::INT64 ? value.i : 0;
+}
+
+uint64_t
+LazyValue::asUInt64() const
+{
+  Number::Bits value;
+  int kind;
+
+  checkedNumber(value, kind);
+  if (kind == Number::UINT64 || (kind == Number::INT64 && value.i >= 0))
+    return value.u;
+  return 0;
+}
+
+double
+LazyValue::asDouble() const
+{
+  Number::Bits value;
+  int kind;
+
+  checkedNumber(value, kind);
+  return Number::toDouble(kind, value);
+}
+
+#endif // __Lazy_h
@@ -0,0 +1,384 @@
+#ifndef __Lexer_h
+#define __Lexer_h
+#include "CharClass.h"
+#include "Escape.h"
+#include "Input.h"
+#include "Stats.h"
+#include "Structural.h"
+#include <string.h>
+#include <string_view>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+class Token
+{
+public:
+  enum TokenType
+  {
+    ERROR = -1,
+    EOF_,
+    STRING,
+    NUMBER,
+    TRUE,
+    FALSE,
+    NULL_
+  }; // TokenType
+
+  int type;
+  string_view lexeme; // lexeme and value of ID
+  char c; // value of CHAR
+
+}; // Token
+
+// Malformed input. Thrown by Lexer::error(), so a caller that parses
+// many documents can report one and go on with the next. The line and
+// column are only worked out once an error is found.
+class ParseError
+{
+public:
+  enum Code
+  {
+    SYNTAX, // a token the grammar does not allow there
+    UTF8, // an invalid UTF-8 sequence
+    UNEXPECTED_END, // the input ends inside a value
+    TRAILING_CONTENT, // something after the root value
+    INVALID_CHARACTER, // a byte that starts no token
+    INVALID_NUMBER,
+    INVALID_LITERAL, // a misspelled true, false or null
+    UNTERMINATED_STRING,
+    INVALID_ESCAPE,
+    CONTROL_CHARACTER, // not escaped in a string
+    REJECTED, // refused by the handler, as a repeated key can be
+    TOO_DEEP // containers nested deeper than the maximum depth
+  }; // Code
+
+  int lineNumber; // line of the error, counted from 1
+  size_t offset; // offset of the error in the input
+  int code;
+  int column; // byte of the error in its line, counted from 1
+
+  ParseError(int lineNumber, size_t offset, int code = SYNTAX, int column = 0):
+    lineNumber(lineNumber),
+    offset(offset),
+    code(code),
+    column(column)
+  {
+    // do nothing
+  }
+
+  // Error at p of input, with its line and column
+  static ParseError at(const char* input, const char* p, int code)
+  {
+    int lineNumber = 1;
+    const char* line = input;
+
+    for (const char* c = input; c < p; c++)
+      if (*c == '\n')
+      {
+        ++lineNumber;
+        line = c + 1;
+      }
+    return ParseError(lineNumber, p - input, code, p - line + 1);
+  }
+
+  // Description of the error, for messages
+  const char* getMessage() const
+  {
+    static const char* const messages[] =
+    {
+      "token inesperado",
+      "UTF-8 invalido",
+      "fim inesperado",
+      "conteudo apos o documento",
+      "caractere invalido",
+      "numero invalido",
+      "literal invalido",
+      "string nao terminada",
+      "escape invalido",
+      "caractere de controle na string",
+      "valor rejeitado",
+      "aninhamento alem da profundidade maxima"
+    };
+
+    return code >= 0 && code <= TOO_DEEP ? messages[code] : "desconhecido";
+  }
+
+}; // ParseError
+
+// Lexical analyser shared by every parser over an Input. Whitespace is
+// skipped by jumping along the structural index.
+class Lexer
+{
+public:
+  Lexer():
+    utf8(false)
+  {
+    // do nothing
+  }
+
+  // Throw ParseError with code for the current position, or for p
+  void error(int code = ParseError::SYNTAX);
+  void error(int code, const char* p);
+
+  // Whether the input must be valid UTF-8; checked along with the
+  // structural index, before any token is read
+  void setValidateUtf8(bool validate)
+  {
+    utf8 = validate;
+  }
+
+protected:
+  const char* input; // beginning of the input
+  const char* end; // end of the input
+  char* buffer; // input buffer
+  Token lookahead; // current token
+  StructuralIndex index; // structural positions of the input
+  const char* origin; // where the positions count from
+  const uint32_t* next; // next structural position
+  const uint32_t* last; // end of the structural positions
+  bool indexed; // whether index covers the input
+  bool utf8; // whether to validate UTF-8
+
+  void start(Input*);
+  void start(Input*, const char*, const char*);
+  bool endOfScalar() const;
+  Token nextToken(); // lexical analyser
+  Token number(char*);
+  Token literal(int, const char*, size_t);
+
+  // Four bytes at p, to compare with those of a literal in one go
+  static uint32_t word(const char* p)
+  {
+    uint32_t w;
+
+    memcpy(&w, p, sizeof(w));
+    return w;
+  }
+
+  void advance()
+  {
+    lookahead = nextToken();
+    Stats::token(lookahead.type);
+  }
+
+  void match(int t)
+  {
+    if (lookahead.type == t)
+      advance();
+    else
+      unexpected();
+  }
+
+  // Error at the lookahead token, which is not one the grammar allows
+  void unexpected()
+  {
+    if (lookahead.type == Token::EOF_)
+      error(ParseError::UNEXPECTED_END, end);
+    error(ParseError::SYNTAX, lookahead.lexeme.data());
+  }
+
+}; // Lexer
+
+void
+Lexer::start(Input* source)
+{
+  input = source->data();
+  end = input + source->size();
+  buffer = const_cast<char*>(input);
+  Stats::scanned(source->size());
+  {
+    Stats::Timer timer(Stats::LEX);
+
+    indexed = index.build(input, source->size(), utf8);
+  }
+  if (utf8 && index.getUtf8Error() < source->size())
+  {
+    buffer += index.getUtf8Error();
+    error(ParseError::UTF8);
+  }
+  origin = input;
+  next = index.begin();
+  last = index.end();
+  advance();
+}
+
+// Lex only the tokens between first and last, which must not be inside
+// a string. They are indexed apart from the rest of the input, which
+// is not checked for UTF-8.
+void
+Lexer::start(Input* source, const char* first, const char* last)
+{
+  input = source->data();
+  end = input + source->size();
+  buffer = const_cast<char*>(first);
+  Stats::scanned(last - first);
+  {
+    Stats::Timer timer(Stats::LEX);
+
+    indexed = index.build(first, last - first);
+  }
+  // Unindexed, the lexer would go on past last
+  if (!indexed)
+    error(ParseError::SYNTAX);
+  origin = first;
+  next = index.begin();
+  this->last = index.end();
+  advance();
+}
+
+void
+Lexer::error(int code)
+{
+  error(code, buffer);
+}
+
+void
+Lexer::error(int code, const char* p)
+{
+  throw ParseError::at(input, p, code);
+}
+
+// Whether the scalar just lexed is followed by a delimiter
+inline bool
+Lexer::endOfScalar() const
+{
+  return CharClass::isDelimiter(*buffer) || buffer == end;
+}
+
+Token
+Lexer::nextToken()
+{
+  Token t;
+
+  if (indexed)
+  {
+    if (next == last)
+    {
+      t.type = Token::EOF_;
+      return t;
+    }
+    buffer = const_cast<char*>(origin) + *next++;
+  }
+  else
+    while (CharClass::isWhitespace(*buffer))
+      ++buffer;
+
+  if (buffer == end)
+  {
+    t.type = Token::EOF_;
+    return t;
+  }
+
+  char* beginLexeme = buffer;
+
+  switch (*buffer)
+  {
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ',':
+    case ':':
+      t.type = *buffer++;
+      t.lexeme = string_view(beginLexeme, 1);
+      return t;
+    case '"':
+    {
+      const char* p = buffer + 1;
+      bool closed = Escape::scan(p, end);
+
+      buffer = const_cast<char*>(p);
+      if (!closed)
+        error(p == end ? ParseError::UNTERMINATED_STRING :
+          (unsigned char)*p < 0x20 ? ParseError::CONTROL_CHARACTER :
+          ParseError::INVALID_ESCAPE);
+      t.c = *buffer++;
+      t.type = Token::STRING;
+      t.lexeme = string_view(beginLexeme, buffer - beginLexeme);
+      return t;
+    }
+    case 't':
+      return literal(Token::TRUE, "true", 4);
+    case 'f':
+      return literal(Token::FALSE, "false", 5);
+    case 'n':
+      return literal(Token::NULL_, "null", 4);
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      return number(beginLexeme);
+  }
+  error(ParseError::INVALID_CHARACTER, beginLexeme);
+  t.type = Token::ERROR;
+  return t;
+}
+
+Token
+Lexer::number(char* beginLexeme)
+{
+  Token t;
+
+  if (*buffer == '-')
+    ++buffer;
+  if (*buffer == '0')
+    ++buffer;
+  else if (CharClass::isDigit(*buffer))
+    while (CharClass::isDigit(*++buffer))
+      ;
+  else
+    error(ParseError::INVALID_NUMBER);
+  if (*buffer == '.')
+  {
+    if (!CharClass::isDigit(*++buffer))
+      error(ParseError::INVALID_NUMBER);
+    while (CharClass::isDigit(*++buffer))
+      ;
+  }
+  if (*buffer == 'e' || *buffer == 'E')
+  {
+    ++buffer;
+    if (*buffer == '+' || *buffer == '-')
+      ++buffer;
+    if (!CharClass::isDigit(*buffer))
+      error(ParseError::INVALID_NUMBER);
+    while (CharClass::isDigit(*++buffer))
+      ;
+  }
+  if (!endOfScalar())
+    error(ParseError::INVALID_NUMBER);
+  t.type = Token::NUMBER;
+  t.lexeme = string_view(beginLexeme, buffer - beginLexeme);
+  return t;
+}
+
+// The literal text of n bytes, 4 or 5, at buffer; compared a word at a
+// time, the last four bytes as a second word when n is 5
+inline Token
+Lexer::literal(int type, const char* text, size_t n)
+{
+  Token t;
+  char* beginLexeme = buffer;
+
+  if ((size_t)(end - buffer) < n || word(buffer) != word(text) ||
+    word(buffer + n - 4) != word(text + n - 4))
+    error(ParseError::INVALID_LITERAL, beginLexeme);
+  buffer += n;
+  t.c = buffer[-1];
+  if (!endOfScalar())
+    error(ParseError::INVALID_LITERAL);
+  t.type = type;
+  t.lexeme = string_view(beginLexeme, n);
+  return t;
+}
+
+#endif // __Lexer_h
@@ -0,0 +1,243 @@
+#ifndef __Ndjson_h
+#define __Ndjson_h
+#include "Parser.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+NDJSON
+======
+Newline-delimited JSON: one document per line, as in log files. The
+input is cut at line ends into batches of about BATCH_SIZE bytes, and
+a pool of worker threads, each with its own Parser, parses the batches
+into trees. The calling thread hands the records to a consumer in the
+order of the input while the workers go on with the next batches; at
+most WINDOW batches per worker are held at a time, so memory stays
+bounded however long the input is. A malformed line is reported to the
+consumer and does not stop the others. Blank lines are skipped.
+
+A consumer provides
+
+  void record(const Ndjson::Record&);
+*/
+
+class Ndjson
+{
+public:
+  struct Record
+  {
+    int lineNumber; // line of the record in the input, counted from 1
+    JsonPtr json; // tree of the record, or 0 if it is malformed
+    ParseError error; // position of the error in the line
+
+    Record(int lineNumber):
+      lineNumber(lineNumber),
+      error(0, 0)
+    {
+      // do nothing
+    }
+  };
+
+  // Constructor; 0 threads means one per processor
+  Ndjson(int numberOfThreads = 0);
+
+  void setValidateUtf8(bool validate)
+  {
+    utf8 = validate;
+  }
+
+  template <typename Consumer> void parse(Input*, Consumer&);
+
+private:
+  enum
+  {
+    BATCH_SIZE = 1 << 20,
+    WINDOW = 4
+  };
+
+  struct Batch
+  {
+    const char* begin;
+    const char* end;
+    int lines; // line ends in the batch
+    bool done;
+    vector<Record> records; // lineNumber relative to the batch
+    ArenaPtr arena; // storage of the trees
+
+    Batch(const char* begin, const char* end):
+      begin(begin),
+      end(end),
+      lines(0),
+      done(false)
+    {
+      // do nothing
+    }
+  };
+
+  int numberOfThreads;
+  bool utf8; // whether to validate UTF-8
+  vector<Batch> batches;
+  size_t next; // next batch to parse
+  size_t emitted; // batches handed to the consumer
+  vector<ArenaPtr> spare; // arenas of emitted batches, kept for reuse
+  mutex lock;
+  condition_variable changed;
+
+  void split(Input*);
+  void work();
+  static void parseBatch(Parser&, Batch&);
+
+}; // Ndjson
+
+Ndjson::Ndjson(int numberOfThreads)
+{
+  if (numberOfThreads <= 0)
+    numberOfThreads = thread::hardware_concurrency();
+  this->numberOfThreads = numberOfThreads > 0 ? numberOfThreads : 1;
+  utf8 = false;
+}
+
+template <typename Consumer>
+void
+Ndjson::parse(Input* source, Consumer& consumer)
+{
+  split(source);
+  next = emitted = 0;
+
+  vector<thread> workers;
+
+  for (int i = 0; i < numberOfThreads; i++)
+    workers.push_back(thread(&Ndjson::work, this));
+
+  int base = 1;
+
+  for (size_t i = 0; i < batches.size(); i++)
+  {
+    Batch& b = batches[i];
+
+    {
+      unique_lock<mutex> guard(lock);
+
+      while (!b.done)
+        changed.wait(guard);
+    }
+    for (size_t j = 0; j < b.records.size(); j++)
+    {
+      b.records[j].lineNumber += base;
+      consumer.record(b.records[j]);
+    }
+    base += b.lines;
+    // Let the trees go before the workers move past the window
+    vector<Record>().swap(b.records);
+
+    unique_lock<mutex> guard(lock);
+
+    // Unless the consumer kept a tree, its arena can take another batch
+    if (b.arena->getNumberOfUses() == 1)
+      spare.push_back(b.arena);
+    b.arena = 0;
+    emitted++;
+    changed.notify_all();
+  }
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+  batches.clear();
+  spare.clear();
+}
+
+// Cut the input into batches that end just after a line end
+void
+Ndjson::split(Input* source)
+{
+  const char* p = source->data();
+  const char* end = p + source->size();
+
+  batches.clear();
+  while (p < end)
+  {
+    const char* q = end;
+
+    if (end - p > BATCH_SIZE)
+    {
+      q = (const char*)memchr(p + BATCH_SIZE, '\n', end - p - BATCH_SIZE);
+      q = q != 0 ? q + 1 : end;
+    }
+    batches.push_back(Batch(p, q));
+    p = q;
+  }
+}
+
+void
+Ndjson::work()
+{
+  Parser parser;
+
+  parser.setValidateUtf8(utf8);
+
+  unique_lock<mutex> guard(lock);
+
+  for (;;)
+  {
+    while (next < batches.size() && next >= emitted + WINDOW * numberOfThreads)
+      changed.wait(guard);
+    if (next == batches.size())
+      return;
+
+    Batch& b = batches[next++];
+
+    if (spare.empty())
+      b.arena = new Arena();
+    else
+    {
+      b.arena = spare.back();
+      b.arena->reset();
+      spare.pop_back();
+    }
+    guard.unlock();
+    parseBatch(parser, b);
+    guard.lock();
+    b.done = true;
+    changed.notify_all();
+  }
+}
+
+// Parse the lines of a batch; the trees share the batch's arena
+void
+Ndjson::parseBatch(Parser& parser, Batch& b)
+{
+  for (const char* p = b.begin; p < b.end; b.lines++)
+  {
+    const char* q = (const char*)memchr(p, '\n', b.end - p);
+    const char* line = p;
+
+    if (q == 0)
+      q = b.end;
+    p = q + 1;
+
+    const char* s = line;
+
+    while (s < q && (*s == ' ' || *s == '\t' || *s == '\r'))
+      ++s;
+    if (s == q)
+      continue;
+    b.records.push_back(Record(b.lines));
+
+    // A line may be parsed in place: the lexer stops at its end, since
+    // no token goes on past a line end
+    Record& r = b.records.back();
+    InputPtr input = new Input(line, q - line);
+
+    try
+    {
+      r.json = parser.parse(input, b.arena);
+    }
+    catch (const ParseError& e)
+    {
+      r.error = e;
+    }
+  }
+}
+
+#endif // __Ndjson_h
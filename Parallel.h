@@ -0,0 +1,301 @@
+#ifndef __Parallel_h
+#define __Parallel_h
+#include "Parser.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+Parallel parser
+===============
+Parses one large document on several threads when its root is an
+array or an object. A structural index of the input is built first; it
+already knows which characters are inside strings, escapes included,
+wherever a block boundary falls. A walk over the index finds the commas
+between the root's children, and the root is cut at some of them into
+pieces of similar size. Each thread indexes and parses the children of
+a piece into a tree in its own arena, and the pieces are joined under
+one root whose arena keeps the others alive.
+
+The index holds 32-bit offsets, so an input of more than WINDOW bytes
+is indexed and walked one window at a time. No position of an index is
+inside a string, even in a window cut in the middle of one, so the next
+window starts at the last position of the one before. Pieces are kept
+under WINDOW bytes too, and there may then be more pieces than threads.
+
+Inputs that are small, that are not a container, or that have an error
+anywhere are parsed again by a sequential Parser, so errors are always
+reported as that parser reports them.
+*/
+
+class ParallelParser
+{
+public:
+  // Constructor; 0 threads means one per processor
+  ParallelParser(int numberOfThreads = 0);
+
+  Json* parse(Input*);
+  void setDuplicateKeys(int); // a Members::DuplicateKeys
+  void setValidateUtf8(bool);
+  void setMaxDepth(size_t);
+
+private:
+  enum
+  {
+    MIN_CHUNK = 1 << 20, // pieces smaller than this are not worth a thread
+    WINDOW = 1 << 30 // most bytes indexed at once, and in a piece
+  };
+
+  struct Chunk
+  {
+    const char* first; // beginning of the piece
+    const char* last; // comma or bracket after it
+    ArenaPtr arena;
+    vector<Value*> children;
+    bool failed;
+
+    Chunk(const char* first, const char* last):
+      first(first),
+      last(last),
+      arena(new Arena()),
+      failed(false)
+    {
+      // do nothing
+    }
+  };
+
+  int numberOfThreads;
+  int duplicates; // policy for repeated member keys
+  bool utf8; // whether to validate UTF-8
+  size_t maxDepth; // most containers open at once
+  StructuralIndex index;
+  Parser parser; // for inputs that are not split
+
+  bool split(Input*, vector<Chunk>&, bool&);
+  void parseChunks(Input*, vector<Chunk>*, atomic<size_t>*, bool);
+  void parseChunk(Input*, Chunk*, bool);
+  Json* join(Input*, vector<Chunk>&, bool);
+
+}; // ParallelParser
+
+ParallelParser::ParallelParser(int numberOfThreads)
+{
+  if (numberOfThreads <= 0)
+    numberOfThreads = thread::hardware_concurrency();
+  this->numberOfThreads = numberOfThreads > 0 ? numberOfThreads : 1;
+  duplicates = Members::LAST_WINS;
+  utf8 = false;
+  maxDepth = Reader::DEFAULT_MAX_DEPTH;
+}
+
+void
+ParallelParser::setDuplicateKeys(int policy)
+{
+  duplicates = policy;
+  parser.setDuplicateKeys(policy);
+}
+
+void
+ParallelParser::setValidateUtf8(bool validate)
+{
+  utf8 = validate;
+  parser.setValidateUtf8(validate);
+}
+
+void
+ParallelParser::setMaxDepth(size_t depth)
+{
+  maxDepth = depth;
+  parser.setMaxDepth(depth);
+}
+
+Json*
+ParallelParser::parse(Input* source)
+{
+  vector<Chunk> chunks;
+  bool object;
+
+  if (numberOfThreads < 2 || source->size() < 2 * MIN_CHUNK ||
+    !split(source, chunks, object))
+    return parser.parse(source);
+
+  vector<thread> workers;
+  atomic<size_t> next(0);
+
+  for (size_t i = 1; i < chunks.size() && (int)i < numberOfThreads; i++)
+    workers.push_back(thread(&ParallelParser::parseChunks, this,
+      source, &chunks, &next, object));
+  parseChunks(source, &chunks, &next, object);
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+
+  Json* j = join(source, chunks, object);
+
+  return j != 0 ? j : parser.parse(source);
+}
+
+// Cut the root container into pieces of about the same size. Returns
+// false if the input is not one container with enough children.
+bool
+ParallelParser::split(Input* source, vector<Chunk>& chunks, bool& object)
+{
+  const char* input = source->data();
+  size_t length = source->size();
+  size_t size = length / numberOfThreads;
+
+  if (size < MIN_CHUNK)
+    size = MIN_CHUNK;
+  if (size > WINDOW / 2)
+    size = WINDOW / 2;
+
+  const char* first = 0; // beginning of the current piece
+  char previous = 0; // last structural character
+  int depth = 0;
+
+  for (size_t base = 0; base < length;)
+  {
+    const char* window = input + base;
+    size_t n = length - base < WINDOW ? length - base : (size_t)WINDOW;
+    bool final = base + n == length;
+
+    if (!index.build(window, n, utf8) && final)
+      return false;
+
+    const uint32_t* p = index.begin();
+    const uint32_t* end = index.end();
+
+    // The last position of a window, whose token may go on past it, is
+    // left to the next one. A window with a single position, as in a
+    // string longer than a window, is not split.
+    if (!final && end - p < 2)
+      return false;
+    if (!final)
+      --end;
+    // Invalid UTF-8 is left to the parser to report as well; a sequence
+    // cut by the end of a window is only looked at in the next one
+    if (index.getUtf8Error() < (final ? n : *end))
+      return false;
+    for (; p < end; ++p)
+    {
+      const char* c = window + *p;
+
+      if (first == 0)
+      {
+        if (*c != '[' && *c != '{')
+          return false;
+        object = *c == '{';
+        first = c + 1;
+        depth = 1;
+      }
+      else if (depth == 0)
+        // Anything after the root is an error for the parser to find
+        return false;
+      else
+        switch (*c)
+        {
+          case '{':
+          case '[':
+            depth++;
+            break;
+          case '}':
+          case ']':
+            if (--depth == 0)
+            {
+              // So is a mismatched bracket or a comma before it
+              if (previous == ',' || *c != (object ? '}' : ']'))
+                return false;
+              chunks.push_back(Chunk(first, c));
+            }
+            break;
+          case ',':
+            if (depth == 1 && (size_t)(c - first) >= size)
+            {
+              chunks.push_back(Chunk(first, c));
+              first = c + 1;
+            }
+            break;
+        }
+      previous = *c;
+    }
+    base += final ? n : *end;
+  }
+  return depth == 0 && chunks.size() > 1;
+}
+
+// Parse the pieces not taken yet by another thread
+void
+ParallelParser::parseChunks(Input* source, vector<Chunk>* chunks,
+  atomic<size_t>* next, bool object)
+{
+  for (size_t i; (i = (*next)++) < chunks->size();)
+    parseChunk(source, &(*chunks)[i], object);
+}
+
+void
+ParallelParser::parseChunk(Input* source, Chunk* c, bool object)
+{
+  Reader reader;
+  TreeBuilder tree;
+
+  reader.setMaxDepth(maxDepth);
+  tree.start(c->arena, duplicates);
+  if (object)
+    tree.startObject();
+  else
+    tree.startArray();
+  try
+  {
+    reader.parseRange(source, c->first, c->last, object, tree);
+    tree.takeChildren(c->children);
+  }
+  catch (const ParseError&)
+  {
+    c->failed = true;
+  }
+}
+
+// Put the children of all pieces under one root; 0 if a piece failed
+Json*
+ParallelParser::join(Input* source, vector<Chunk>& chunks, bool object)
+{
+  vector<Value*> children;
+
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    if (chunks[i].failed)
+      return 0;
+    children.insert(children.end(),
+      chunks[i].children.begin(), chunks[i].children.end());
+  }
+
+  ArenaPtr arena = new Arena();
+  Value* v = new (*arena) Value();
+
+  for (size_t i = 0; i < chunks.size(); i++)
+    arena->adopt(chunks[i].arena);
+  if (object)
+  {
+    Members* m = new (*arena) Members(arena, duplicates);
+
+    m->assign(&children[0], children.size());
+    if (duplicates == Members::REJECT && m->hasDuplicates())
+      return 0;
+    v->o = new (*arena) Obj(m);
+  }
+  else
+  {
+    Elements* e = new (*arena) Elements(arena);
+
+    e->assign(&children[0], children.size());
+    v->a = new (*arena) Arr(e);
+  }
+
+  Json* j = new Json();
+
+  j->v = v;
+  j->input = source;
+  j->arena = arena;
+  return j;
+}
+
+#endif // __Parallel_h
@@ -1,1008 +1,976 @@
-#ifndef __Parser_h
-#define __Parser_h
-#include "Writer.h"
-#include <ctype.h>
-#include <string>
-#include <stdio.h>
-#include <stdlib.h>
-
-class Object
-{
-public:
-  // Destructor
-  virtual ~Object(){
-    // do nothing
-  }
-
-  // Make a deep-copy of this object
-  virtual Object* clone() const{
-    return 0;
-  }
-
-  // Get number of uses of this object
-  int getNumberOfUses() const
-  {
-    return counter;
-  }
-
-  template <typename T> friend T* makeUse(T*);
-
-  // Release this object
-  void release()
-  {
-    if (--counter <= 0)
-      delete this;
-  }
-
-protected:
-  // Protected default constructor
-  Object():
-    counter(0)
-  {
-    // do nothing
-  }
-
-private:
-  int counter; // reference counter
-
-}; // Object
-
-template <typename T>
-inline T*
-makeUse(T* object)
-{
-  if (object != 0)
-    ++object->counter;
-  return object;
-}
-
-template <typename T>
-inline void
-release(T* object)
-{
-  if (object != 0)
-    object->release();
-}
-
-template <typename T>
-class ObjectPtr
-{
-public:
-  // Constructors
-  ObjectPtr():
-    object(0)
-  {
-    // do nothing
-  }
-
-  ObjectPtr(const ObjectPtr<T>& ptr)
-  {
-    this->object = makeUse(ptr.object);
-  }
-
-  ObjectPtr(T* object)
-  {
-    this->object = makeUse(object);
-  }
-
-  // Destructor
-  ~ObjectPtr()
-  {
-    release(this->object);
-  }
-
-  ObjectPtr<T>& operator =(T* object)
-  {
-    release(this->object);
-    this->object = makeUse(object);
-    return *this;
-  }
-
-  ObjectPtr<T>& operator =(const ObjectPtr<T>& ptr)
-  {
-    release(this->object);
-    this->object = makeUse(ptr.object);
-    return *this;
-  }
-
-  bool operator ==(T* object) const
-  {
-    return this->object == object;
-  }
-
-  bool operator ==(const ObjectPtr<T>& ptr) const
-  {
-    return this->object == ptr.object;
-  }
-
-  bool operator !=(T* object) const
-  {
-    return !operator ==(object);
-  }
-
-  bool operator !=(const ObjectPtr<T>& ptr) const
-  {
-    return !operator ==(ptr);
-  }
-
-  operator T*() const
-  {
-    return this->object;
-  }
-
-  T* operator ->() const
-  {
-    return object;
-  }
-
-private:
-  T* object; // this is the object
-
-};
-template <typename E> class Iterator;
-
-template <typename E>
-class Collection: public Object
-{
-public:
-  virtual ~Collection()
-  {
-    // do nothing
-  }
-
-  virtual bool add(const E&) = 0;
-  virtual bool addAll(const Collection<E>&) = 0;
-  virtual bool remove(const E&) = 0;
-  virtual void clear() = 0;
-
-  virtual bool contains(const E&) const = 0;
-  virtual int size() const = 0;
-  virtual bool isEmpty() const = 0;
-  virtual ObjectPtr<Iterator<E> > iterator() const = 0;
-
-};
-
-template <typename E>
-class Iterator: public Object
-{
-public:
-  virtual ~Iterator()
-  {
-    // do nothing
-  }
-
-  virtual bool hasNext() const = 0;
-
-  virtual E& next() = 0;
-  virtual void restart() = 0;
-
-};
-
-template <typename E> class LinkedListIterator;
-
-template <typename E>
-struct LinkedListElement
-{
-  E value;
-  LinkedListElement<E>* next;
-  LinkedListElement<E>* prev;
-
-  // Constructor
-  LinkedListElement(const E& aValue):
-    value(aValue)
-  {
-    // do nothing
-  }
-
-};
-
-template <typename E>
-class LinkedList: public Collection<E>
-{
-public:
-  // Constructor
-  LinkedList()
-  {
-    head = tail = 0;
-    numberOfElements = 0;
-  }
-
-  // Destructor
-  ~LinkedList();
-
-  bool add(const E&);
-  bool addAll(const Collection<E>&);
-  bool remove(const E&);
-  void clear();
-
-  bool contains(const E&) const;
-  int size() const;
-  bool isEmpty() const;
-  ObjectPtr<Iterator<E> > iterator() const;
-
-  const E& getFirst() const
-  {
-    return this->head->value;
-  }
-
-  Object* clone() const;
-  bool operator ==(const LinkedList<E>&) const;
-
-protected:
-  LinkedListElement<E>* head;
-  LinkedListElement<E>* tail;
-  int numberOfElements;
-
-  LinkedListElement<E>* find(const E&) const;
-
-  LinkedList(const LinkedList<E>&);
-  LinkedList<E>& operator =(const LinkedList<E>&);
-
-  friend class LinkedListIterator<E>;
-
-};
-
-template <typename E>
-class LinkedListIterator: public Iterator<E>
-{
-public:
-  LinkedListIterator(const LinkedList<E>& list)
-  {
-    current = head = list.head;
-  }
-
-  bool hasNext() const;
-
-  E& next();
-  void restart();
-
-private:
-  LinkedListElement<E>* head;
-  LinkedListElement<E>* current;
-
-};
-
-template <typename E>
-LinkedList<E>::~LinkedList()
-{
-  clear();
-}
-
-template <typename E>
-bool
-LinkedList<E>::add(const E& value)
-{
-  LinkedListElement<E>* e = new LinkedListElement<E>(value);
-
-  e->next = 0;
-  e->prev = tail;
-  if (tail == 0)
-    head = e;
-  else
-    tail->next = e;
-  tail = e;
-  numberOfElements++;
-  return true;
-}
-
-template <typename E>
-bool
-LinkedList<E>::addAll(const Collection<E>& c)
-{
-  bool changed = false;
-
-  for (ObjectPtr<Iterator<E> > i = c.iterator(); i->hasNext();)
-    changed |= add(i->next());
-  return changed;
-}
-
-template <typename E>
-bool
-LinkedList<E>::remove(const E& value)
-{
-  LinkedListElement<E>* e = find(value);
-
-  if (e == 0)
-    return false;
-  if (e == head)
-    head = e->next;
-  else
-    e->prev->next = e->next;
-  if (e == tail)
-    tail = e->prev;
-  else
-    e->next->prev = e->prev;
-  delete e;
-  numberOfElements--;
-  return true;
-}
-
-template <typename E>
-void
-LinkedList<E>::clear()
-{
-  while (head != 0)
-  {
-    LinkedListElement<E>* temp = head;
-
-    head = head->next;
-    delete temp;
-  }
-  tail = 0;
-  numberOfElements = 0;
-}
-
-template <typename E>
-bool
-LinkedList<E>::contains(const E& value) const
-{
-  return find(value) != 0;
-}
-
-template <typename E>
-int
-LinkedList<E>::size() const
-{
-  return numberOfElements;
-}
-
-template <typename E>
-bool
-LinkedList<E>::isEmpty() const
-{
-  return numberOfElements == 0;
-}
-
-template <typename E>
-ObjectPtr<Iterator<E> >
-LinkedList<E>::iterator() const
-{
-  return new LinkedListIterator<E>(*this);
-}
-
-template <typename E>
-LinkedListElement<E>*
-LinkedList<E>::find(const E& value) const
-{
-  for (LinkedListElement<E>* e = head; e != 0; e = e->next)
-    if (value == e->value)
-      return e;
-  return 0;
-}
-
-template <typename E>
-Object*
-LinkedList<E>::clone() const
-{
-  LinkedList<E>* c = new LinkedList<E>();
-
-  for (LinkedListElement<E>* e = head; e != 0; e = e->next)
-    c->add(e->value);
-  return c;
-}
-
-template <typename E>
-bool
-LinkedList<E>::operator ==(const LinkedList<E>& list) const
-{
-  if (numberOfElements != list.numberOfElements)
-    return false;
-
-  LinkedListElement<E>* e1 = head;
-  LinkedListElement<E>* e2 = list.head;
-
-  for (; e1 != 0; e1 = e1->next, e2 = e2->next)
-    if (e1->value != e2->value)
-      return false;
-  return true;
-}
-
-template <typename E>
-bool
-LinkedListIterator<E>::hasNext() const
-{
-  return current != 0;
-}
-
-template <typename E>
-E&
-LinkedListIterator<E>::next()
-{
-  E& value = current->value;
-
-  current = current->next;
-  return value;
-}
-
-template <typename E>
-void
-LinkedListIterator<E>::restart()
-{
-  current = head;
-}
-
-class Node: public Object
-    {
-        public:
-          virtual void write(Writer&) const = 0;
-    };
-
-template <typename Node>
-class List
-{
-public:
-  typedef ObjectPtr<Iterator<ObjectPtr<Node> > > IteratorPtr;
-
-  void add(Node* node)
-  {
-    this->nodes.add(node);
-  }
-
-  bool isEmpty() const
-  {
-    return this->nodes.isEmpty();
-  }
-
-  int size() const
-  {
-    return this->nodes.size();
-  }
-
-  IteratorPtr iterator() const
-  {
-    return this->nodes.iterator();
-  }
-
-  Node* getFirst() const
-  {
-    return nodes.getFirst();
-  }
-
-  void writeList(Writer& writer) const
-  {
-    if (this->nodes.isEmpty())
-      return;
-    for (IteratorPtr i = this->iterator(); i->hasNext();)
-      i->next()->write(writer);
-  }
-
-  void writeList(Writer& writer, const wchar_t* sep) const
-  {
-    int count = this->nodes.size();
-
-    if (count == 0)
-      return;
-    for (IteratorPtr i = this->iterator(); i->hasNext();)
-    {
-      i->next()->write(writer);
-      if (--count > 0)
-        writer.write(sep);
-    }
-  }
-
-private:
-  LinkedList<ObjectPtr<Node> > nodes;
-
-};
-
-
-class Value;
-class Arr;
-class Obj;
-class Elements;
-class Members;
-
-using namespace std;
-class Json: public Node
-{
-public:
-    Value* v;
-    Json()
-    {
-        v = NULL;
-    }
-    void write(Writer &writer) const;
-};
-    typedef ObjectPtr<Json> JsonPtr;
-
-class Value: public Node
-{
-public:
-    Obj* o;
-    Arr* a;
-    int q;
-    string lexeme;
-    string st;
-    Value()
-    {
-        o = NULL;
-        a = NULL;
-        st = '\0';
-    }
-    void write(Writer &writer) const;
-};
-	typedef ObjectPtr<Value> ValuePtr;
-
-class Obj : public Value
-{
-public:
-    Members* m;
-    Obj()
-    {
-        m=NULL;
-    }
-    Obj(Members* n)
-    {
-        m = n;
-    }
-    void write(Writer &writer) const;
-};
-	typedef ObjectPtr<Obj> ObjPtr;
-
-class Members: public Obj, public List<Value>
-{
-public:
-    Members()
-    {
-        // do nothing
-    }
-    void write(Writer &writer) const;
-};
-    typedef ObjectPtr<Members> MembersPtr;
-
-class Arr: public Value
-{
-public:
-    Elements* e;
-    Arr()
-    {
-        e = NULL;
-    }
-    Arr(Elements* e)
-    {
-        this->e = e;
-    }
-    void write(Writer &writer) const;
-};
-    typedef ObjectPtr<Arr> ArrPtr;
-
-class Elements : public Arr, public List<Value>
-{
-public:
-    Elements()
-    {
-        // do nothing
-    }
-    void write(Writer &writer) const;
-};
-	typedef ObjectPtr<Elements> ElementsPtr;
-
-/*Declaracao do Write*/
-
-void Json::write(Writer &writer) const
-{
-    writer.beginLine();
-    writer.write(L"Json");
-    writer.endLine();
-    writer.beginBlock();
-    v->write(writer);
-    writer.backspace();
-    writer.endBlock();
-}
-void Value::write(Writer &writer) const
-{
-    writer.beginLine();
-    if(q == 10)
-        writer.write(L"%s:",st.c_str());
-    if(a != NULL){
-        writer.write(L"Value");
-        writer.endLine();
-        writer.beginBlock();
-        a->write(writer);
-        writer.endBlock();
-    }
-    else if(o != NULL){
-        writer.write(L"Value");
-        writer.endLine();
-        writer.beginBlock();
-        o->write(writer);
-        writer.endBlock();
-    }
-    else if(q != 0){
-        writer.write(L"%s",lexeme.c_str());
-        writer.endLine();
-    }
-}
-void Obj::write(Writer &writer) const
-{
-    writer.beginLine();
-    writer.write(L"Object");
-    writer.endLine();
-    writer.beginBlock();
-    if(m != NULL)
-        m->write(writer);
-    writer.endBlock();
-}
-void Members::write(Writer &writer) const
-{
-    List<Value>::writeList(writer);
-}
-void Arr::write(Writer &writer) const
-{
-    writer.beginLine();
-    writer.write(L"Array");
-    writer.endLine();
-    writer.beginBlock();
-    if(e != NULL)
-        e->write(writer);
-    writer.endBlock();
-}
-void Elements::write(Writer &writer) const
-{
-    List<Value>::writeList(writer);
-}
-
-class Token
-{
-public:
-  enum TokenType
-  {
-    ERROR = -1,
-    EOF_,
-    STRING,
-    NUMBER,
-    TRUE,
-    FALSE,
-    NULL_
-  }; // TokenType
-
-  int type;
-  string lexeme; // lexeme and value of ID
-  char c; // value of CHAR
-
-}; // Token
-
-class Parser
-{
-public:
-  Json* parse(const char*);
-  Parser();
-private:
-  char* buffer; // input buffer
-  int lineNumber; // current line number
-  Token lookahead; // current token
-
-  void error();
-  Token nextToken(); // lexical analyser
-
-  void advance()
-  {
-    lookahead = nextToken();
-  }
-
-  void match(int t)
-  {
-    if (lookahead.type == t)
-      advance();
-    else
-      error();
-  }
-
-  Json* json();
-  Value* value();
-  Obj* object();
-  Members* members();
-  Value* pairs();
-  Arr* arrays();
-  Elements* elements();
-
-}; // Parser
-
-//Construtor do Parser, inicializa com todos os valores em zero
-Parser::Parser()
-{
-}
-
-Json*
-Parser::parse(const char* input)
-{
-  buffer = const_cast<char*>(input);
-  lineNumber = 1;
-  lookahead = nextToken();
-  Json* J= json();
-  if (lookahead.type != Token::EOF_)
-    error();
-  return J;
-}
-
-void
-Parser::error()
-{
-  printf("**Error (%d): %s\n", lineNumber, "desconhecido");
-  
-  exit(1);
-}
-
-Token
-Parser::nextToken()
-{
-  while (isspace(*buffer))
-    if (*buffer++ == '\n')
-      ++lineNumber;
-
-  Token t;
-  if (*buffer == '\0')
-  {
-        t.type = Token::EOF_;
-        return t;
-  }
-
-  char* beginLexeme = buffer;
-
-  if (*buffer == '-' || isdigit(*buffer))
-  {
-    if(*buffer == '-')
-      ++buffer;
-
-    if(*buffer != '0'){
-      ++buffer;
-      while(isdigit(*buffer))
-        ++buffer;
-    }
-    else
-        ++buffer;
-
-
-    if(*buffer == '.'){
-      ++buffer;
-      if(isdigit(*buffer))
-        ++buffer;
-      else
-	error();
-      while (isdigit(*buffer))
-        ++buffer;
-    }
-
-    if(*buffer == 'e' || *buffer == 'E'){
-      ++buffer;
-      if(*buffer == '+' || *buffer == '-')
-      ++buffer;
-      if(isdigit(*buffer))
-        ++buffer;
-      else
-	error();
-      while (isdigit(*buffer))
-        ++buffer;
-    }
-
-    t.type = Token::NUMBER;
-    t.lexeme = string(beginLexeme, buffer);
-    return t;
-  }
-
-  if (*buffer == 34)
-  {
-    ++buffer;
-    while (*buffer != 34){
-      if (*buffer == 9 || *buffer == 10){
-        error();
-      }
-      else if(*buffer == 92){
-        ++buffer;
-        if(*buffer == 34 || *buffer == 10 || *buffer == 9 || *buffer == 92){
-         ++buffer;
-        }
-        else
-         error();
-      }
-      else
-        ++buffer;
-    }
-    t.c = *buffer++;
-    t.type = Token::STRING;
-    t.lexeme = string(beginLexeme, buffer);
-    return t;
-  }
-
-  if (*buffer == 't')
-  {
-   ++buffer;
-    if(*buffer == 'r'){
-      ++buffer;
-      if(*buffer == 'u'){
-        ++buffer;
-          if(*buffer == 'e'){
-            t.c = *buffer++;
-            t.type = Token::TRUE;
-            t.lexeme = string(beginLexeme, buffer);
-            return t;
-          }
-       }
-    }
-  }
-
-  if (*buffer == 'f')
-  {
-    ++buffer;
-    if(*buffer == 'a'){
-      ++buffer;
-      if(*buffer == 'l'){
-        ++buffer;
-          if(*buffer == 's'){
-            ++buffer;
-            if(*buffer == 'e'){
-              t.c = *buffer++;
-              t.type = Token::FALSE;
-              t.lexeme = string(beginLexeme, buffer);
-              return t;
-            }
-          }
-      }
-    }
-  }
-
-
-  if (*buffer == 'n')
-  {
-    ++buffer;
-    if(*buffer == 'u'){
-      ++buffer;
-      if(*buffer == 'l'){
-        ++buffer;
-          if(*buffer == 'l'){
-            t.c = *buffer++;
-            t.type = Token::NULL_;
-            t.lexeme = string(beginLexeme, buffer);
-            return t;
-          }
-       }
-     }
-   }
-  char c = *buffer++;
-
-  switch (c)
-  {
-    case '{':
-    case '}':
-    case '[':
-    case ']':
-    case '+':
-    case ',':
-    case ':':
-      t.type = c;
-      t.lexeme = string(beginLexeme, buffer);
-      return t;
-  }
-
-
-  error();
-  t.type = Token::ERROR;
-
-  return t;
-}
-
-/***********************
-Implementacao das Producoes
-***********************/
-Json*
-Parser::json()
-{
-	Json* j = new Json();
-	Value* v = value();
-	j->v = v;
-	if (lookahead.type == Token::EOF_)
-		advance();
-	else
-		error();
-    return j;
-}
-
-Value*
-Parser::value()
-{
-	Value* v = new Value();
-	switch (lookahead.type)
-	{
-	case '{':
-		v->o = object();
-		break;
-	case '[':
-		v->a = arrays();
-		break;
-	case Token::STRING:
-	case Token::NUMBER:
-	case Token::TRUE:
-	case Token::FALSE:
-	case Token::NULL_:
-		v->q = lookahead.type;
-		v->lexeme = lookahead.lexeme;
-		advance();
-		break;
-	default:
-		error();
-	}
-	return v;
-}
-
-Obj*
-Parser::object()
-{
-	Obj* o;
-	if (lookahead.type == '{') {
-		match('{');
-		if (lookahead.type == '}'){
-			o = new Obj();
-			match('}');
-		}
-		else {
-			Members* m = members();
-			match('}');
-			o = new Obj(m);
-		}
-	}
-	else
-		error();
-    return o;
-}
-
-Members*
-Parser::members()
-{
-	Members* m = new Members();
-	for (;; advance()) {
-		m->add(pairs());
-		if (lookahead.type != ',')
-			return m;
-	}
-}
-
-Value*
-Parser::pairs()
-{
-	if (lookahead.type == Token::STRING) {
-		Value* v;
-		string a = lookahead.lexeme;
-		advance();
-		match(':');
-		v = value();
-		v->q = 10;
-		v->st = a;
-		return v;
-	}
-	else
-		error();
-    return 0;
-}
-
-Arr*
-Parser::arrays()
-{
-	Arr* a;
-	if (lookahead.type == '[') {
-		match('[');
-		if (lookahead.type == ']') {
-			match(']');
-			a = new Arr();
-		}
-		else {
-			Elements* e = elements();
-			a = new Arr(e);
-			match(']');
-		}
-	}
-	else
-		error();
-    return a;
-}
-
-Elements*
-Parser::elements()
-{
-	Elements* e = new Elements();
-	for (;; advance()) {
-		e->add(value());
-		if (lookahead.type != ',')
-			return e;
-	}
-}
-#endif
+#ifndef __Parser_h
+#define __Parser_h
+#include "Writer.h"
+#include "Object.h"
+#include "Input.h"
+#include "Arena.h"
+#include "Tape.h"
+#include "Reader.h"
+#include "Number.h"
+#include <string>
+#include <string_view>
+#include <string.h>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A node of a tree. Nodes live in the arena of their document, which
+// frees them all at once: they are not reference counted, and cannot
+// be deleted one by one.
+class Node
+    {
+        public:
+          virtual void write(Writer&) const = 0;
+        protected:
+          ~Node()
+          {
+              // do nothing
+          }
+    };
+
+// Children of a container, stored contiguously. Short lists live in
+// the node itself; longer ones in a block taken from the arena, or from
+// the heap when there is no arena.
+template <typename Node>
+class List
+{
+public:
+  // Constructor
+  List(Arena* arena = 0):
+    nodes(inlineNodes),
+    count(0),
+    capacity(INLINE),
+    arena(arena)
+  {
+    // do nothing
+  }
+
+  // Destructor
+  ~List()
+  {
+    if (arena == 0 && nodes != inlineNodes)
+      delete[] nodes;
+  }
+
+  void add(Node* node)
+  {
+    if (count == capacity)
+      reserve(2 * capacity);
+    nodes[count++] = node;
+  }
+
+  // Replace the contents with n nodes, using exactly the room they need
+  void assign(Node* const* first, int n)
+  {
+    count = 0;
+    if (n > capacity)
+      reserve(n);
+    memcpy(nodes, first, n * sizeof(Node*));
+    count = n;
+  }
+
+  bool isEmpty() const
+  {
+    return count == 0;
+  }
+
+  int size() const
+  {
+    return count;
+  }
+
+  Node* operator [](int i) const
+  {
+    return nodes[i];
+  }
+
+  Node* const* begin() const
+  {
+    return nodes;
+  }
+
+  Node* const* end() const
+  {
+    return nodes + count;
+  }
+
+  Node* getFirst() const
+  {
+    return nodes[0];
+  }
+
+  Arena* getArena() const
+  {
+    return arena;
+  }
+
+  void writeList(Writer& writer) const
+  {
+    for (Node* const* i = begin(); i != end(); ++i)
+      (*i)->write(writer);
+  }
+
+private:
+  enum { INLINE = 4 };
+
+  Node** nodes; // children
+  int count; // number of children
+  int capacity; // room in nodes
+  Arena* arena; // storage of grown lists
+  Node* inlineNodes[INLINE]; // storage of short lists
+
+  void reserve(int n)
+  {
+    Node** temp = arena != 0 ?
+      (Node**)arena->allocate(n * sizeof(Node*), sizeof(Node*)) :
+      new Node*[n];
+
+    memcpy(temp, nodes, count * sizeof(Node*));
+    if (arena == 0 && nodes != inlineNodes)
+      delete[] nodes;
+    nodes = temp;
+    capacity = n;
+  }
+
+  List(const List<Node>&);
+  List<Node>& operator =(const List<Node>&);
+
+};
+
+
+class Value;
+class Arr;
+class Obj;
+class Elements;
+class Members;
+
+using namespace std;
+// A document: the root of a tree, with the input and the arena the
+// tree refers to, which it keeps alive
+class Json: public Object
+{
+public:
+    Value* v;
+    InputPtr input; // text the tree refers to
+    ArenaPtr arena; // storage of the tree nodes
+    Json()
+    {
+        v = NULL;
+    }
+    void write(Writer &writer) const;
+};
+    typedef ObjectPtr<Json> JsonPtr;
+
+class Value: public Node
+{
+public:
+    Obj* o;
+    Arr* a;
+    string_view lexeme;
+    string_view st;
+    int q;
+    Value()
+    {
+        o = NULL;
+        a = NULL;
+        q = 0;
+        kind = -1;
+    }
+    // Typed access to numbers, decoded on first use
+    bool isNumber() const;
+    bool isInt64() const;
+    bool isUInt64() const;
+    int64_t asInt64() const; // 0 unless isInt64()
+    uint64_t asUInt64() const; // 0 unless isUInt64()
+    double asDouble() const; // 0 unless isNumber()
+    // Make the value a number. It is written from its value from then
+    // on, while numbers only read keep their lexeme.
+    void setInt64(int64_t);
+    void setUInt64(uint64_t);
+    void setDouble(double);
+    // Write the text of a number set above to out, which has room for
+    // Number::MAX_LENGTH bytes; returns its length
+    int formatNumber(char* out) const;
+    // Contents of a string value and key of a member, unescaped to
+    // UTF-8; empty for other values
+    string getString() const;
+    string getKey() const;
+    void write(Writer &writer) const;
+private:
+    mutable int kind; // Number::Kind of number, -1 until decoded
+    mutable Number::Bits number; // decoded value
+    int numberKind() const
+    {
+        if (kind < 0)
+            kind = Number::decode(lexeme, number);
+        return kind;
+    }
+    void setNumber(int);
+};
+
+class Obj : public Value
+{
+public:
+    Members* m;
+    Obj()
+    {
+        m=NULL;
+    }
+    Obj(Members* n)
+    {
+        m = n;
+    }
+    Value* get(string_view) const; // member named key, unescaped
+    void write(Writer &writer) const;
+};
+
+class Members: public Obj, public List<Value>
+{
+public:
+    // Which member get() returns when a key repeats
+    enum DuplicateKeys
+    {
+        LAST_WINS,
+        FIRST_WINS,
+        REJECT // the parser fails on repeated keys
+    };
+    Members(Arena* arena = 0, int duplicates = LAST_WINS):
+        List<Value>(arena)
+    {
+        this->duplicates = duplicates;
+        index = NULL;
+        mask = 0;
+        unique = true;
+    }
+    ~Members()
+    {
+        if (getArena() == 0)
+            delete[] index;
+    }
+    Value* get(string_view) const; // member named key, unescaped
+    bool hasDuplicates() const;
+    void write(Writer &writer) const;
+private:
+    // Objects with fewer members are searched linearly
+    enum { INDEX_THRESHOLD = 16 };
+
+    int duplicates; // DuplicateKeys
+    mutable uint32_t* index; // open addressing table of positions + 1
+    mutable uint32_t mask; // size of index - 1
+    mutable bool unique; // no key repeats, valid once index is built
+
+    void buildIndex() const;
+    static uint32_t hash(string_view);
+    static uint32_t hashKey(const Value*);
+    static bool sameKey(const Value*, string_view);
+    static bool sameKeys(const Value*, const Value*);
+    static string_view keyOf(const Value* v)
+    {
+        return v->st.substr(1, v->st.size() - 2);
+    }
+    static bool isEscaped(string_view key)
+    {
+        return memchr(key.data(), '\\', key.size()) != NULL;
+    }
+};
+
+class Arr: public Value
+{
+public:
+    Elements* e;
+    Arr()
+    {
+        e = NULL;
+    }
+    Arr(Elements* e)
+    {
+        this->e = e;
+    }
+    int size() const; // number of elements
+    Value* get(int) const; // element i, or NULL if there is none
+    void write(Writer &writer) const;
+};
+
+class Elements : public Arr, public List<Value>
+{
+public:
+    Elements(Arena* arena = 0):
+        List<Value>(arena)
+    {
+        // do nothing
+    }
+    using List<Value>::size;
+    void write(Writer &writer) const;
+};
+
+/*Declaracao do Write*/
+
+void Json::write(Writer &writer) const
+{
+    writer.beginLine();
+    writer.write("Json");
+    writer.endLine();
+    writer.beginBlock();
+    v->write(writer);
+    writer.backspace();
+    writer.endBlock();
+}
+void Value::write(Writer &writer) const
+{
+    writer.beginLine();
+    if(q == 10){
+        writer.write(st);
+        writer.write(':');
+    }
+    if(a != NULL){
+        writer.write("Value");
+        writer.endLine();
+        writer.beginBlock();
+        a->write(writer);
+        writer.endBlock();
+    }
+    else if(o != NULL){
+        writer.write("Value");
+        writer.endLine();
+        writer.beginBlock();
+        o->write(writer);
+        writer.endBlock();
+    }
+    else if(q != 0){
+        if(lexeme.empty()){
+            char text[Number::MAX_LENGTH];
+            writer.write(text, formatNumber(text));
+        }
+        else
+            writer.write(lexeme);
+        writer.endLine();
+    }
+}
+void Obj::write(Writer &writer) const
+{
+    writer.beginLine();
+    writer.write("Object");
+    writer.endLine();
+    writer.beginBlock();
+    if(m != NULL)
+        m->write(writer);
+    writer.endBlock();
+}
+void Members::write(Writer &writer) const
+{
+    List<Value>::writeList(writer);
+}
+void Arr::write(Writer &writer) const
+{
+    writer.beginLine();
+    writer.write("Array");
+    writer.endLine();
+    writer.beginBlock();
+    if(e != NULL)
+        e->write(writer);
+    writer.endBlock();
+}
+/*Numeros*/
+
+bool Value::isNumber() const
+{
+    return numberKind() != Number::NONE;
+}
+bool Value::isInt64() const
+{
+    return numberKind() == Number::INT64;
+}
+// Non-negative int64 values are uint64 values too
+bool Value::isUInt64() const
+{
+    return numberKind() == Number::UINT64 || (isInt64() && number.i >= 0);
+}
+int64_t Value::asInt64() const
+{
+    return isInt64() ? number.i : 0;
+}
+uint64_t Value::asUInt64() const
+{
+    return isUInt64() ? number.u : 0;
+}
+double Value::asDouble() const
+{
+    return Number::toDouble(numberKind(), number);
+}
+void Value::setNumber(int k)
+{
+    o = NULL;
+    a = NULL;
+    lexeme = string_view();
+    if (q != 10)
+        q = Token::NUMBER;
+    kind = k;
+}
+void Value::setInt64(int64_t i)
+{
+    number.i = i;
+    setNumber(Number::INT64);
+}
+// As decode() does, only values above INT64_MAX are UINT64
+void Value::setUInt64(uint64_t u)
+{
+    number.u = u;
+    setNumber(u > INT64_MAX ? Number::UINT64 : Number::INT64);
+}
+void Value::setDouble(double d)
+{
+    number.d = d;
+    setNumber(Number::DOUBLE);
+}
+int Value::formatNumber(char* out) const
+{
+    return Number::format(numberKind(), number, out);
+}
+/*Strings*/
+
+string Value::getString() const
+{
+    string s;
+    if (o == NULL && a == NULL && !lexeme.empty() && lexeme[0] == '"')
+        Escape::unescape(lexeme.substr(1, lexeme.size() - 2), s);
+    return s;
+}
+string Value::getKey() const
+{
+    string s;
+    if (q == 10)
+        Escape::unescape(st.substr(1, st.size() - 2), s);
+    return s;
+}
+/*Busca de membros*/
+
+Value* Obj::get(string_view key) const
+{
+    return m != NULL ? m->get(key) : NULL;
+}
+
+// Key lookup: a linear scan for small objects, a hash index built on
+// the first lookup for large ones. Keys are compared unescaped, which
+// only costs a copy for the few keys that have escapes. Building the
+// index writes to the object, so the first get() or hasDuplicates() of
+// an object of INDEX_THRESHOLD members or more must not run alongside
+// another call on it: a tree shared by threads is safe once every such
+// object has been looked up, or checked for duplicates, before sharing.
+Value* Members::get(string_view key) const
+{
+    int n = size();
+
+    if (n < INDEX_THRESHOLD) {
+        if (duplicates == FIRST_WINS) {
+            for (int i = 0; i < n; i++)
+                if (sameKey((*this)[i], key))
+                    return (*this)[i];
+        }
+        else
+            for (int i = n - 1; i >= 0; i--)
+                if (sameKey((*this)[i], key))
+                    return (*this)[i];
+        return NULL;
+    }
+    if (index == NULL)
+        buildIndex();
+    for (uint32_t h = hash(key) & mask; index[h] != 0; h = (h + 1) & mask) {
+        Value* v = (*this)[index[h] - 1];
+        if (sameKey(v, key))
+            return v;
+    }
+    return NULL;
+}
+
+bool Members::hasDuplicates() const
+{
+    int n = size();
+
+    if (n < INDEX_THRESHOLD) {
+        for (int i = 1; i < n; i++)
+            for (int j = 0; j < i; j++)
+                if (sameKeys((*this)[i], (*this)[j]))
+                    return true;
+        return false;
+    }
+    if (index == NULL)
+        buildIndex();
+    return !unique;
+}
+
+void Members::buildIndex() const
+{
+    int n = size();
+    uint32_t capacity = 1;
+
+    while (capacity < 2 * (uint32_t)n)
+        capacity <<= 1;
+    if (getArena() != 0)
+        index = (uint32_t*)getArena()->allocate(capacity * sizeof(uint32_t));
+    else
+        index = new uint32_t[capacity];
+    memset(index, 0, capacity * sizeof(uint32_t));
+    mask = capacity - 1;
+    for (int i = 0; i < n; i++) {
+        Value* v = (*this)[i];
+        uint32_t h = hashKey(v) & mask;
+
+        while (index[h] != 0 && !sameKeys((*this)[index[h] - 1], v))
+            h = (h + 1) & mask;
+        if (index[h] != 0) {
+            unique = false;
+            if (duplicates == FIRST_WINS)
+                continue;
+        }
+        index[h] = i + 1;
+    }
+}
+
+// Hash of the unescaped key of member v
+uint32_t Members::hashKey(const Value* v)
+{
+    string_view key = keyOf(v);
+
+    if (!isEscaped(key))
+        return hash(key);
+
+    string s;
+    Escape::unescape(key, s);
+    return hash(s);
+}
+
+// Whether the unescaped key of member v is key
+bool Members::sameKey(const Value* v, string_view key)
+{
+    string_view k = keyOf(v);
+
+    // Escapes only make a key longer
+    if (k.size() < key.size())
+        return false;
+    if (!isEscaped(k))
+        return k == key;
+
+    string s;
+    Escape::unescape(k, s);
+    return s == key;
+}
+
+bool Members::sameKeys(const Value* v, const Value* w)
+{
+    string_view k = keyOf(w);
+
+    if (!isEscaped(k))
+        return sameKey(v, k);
+
+    string s;
+    Escape::unescape(k, s);
+    return sameKey(v, s);
+}
+
+// FNV-1a
+uint32_t Members::hash(string_view key)
+{
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < key.size(); i++)
+        h = (h ^ (unsigned char)key[i]) * 16777619u;
+    return h;
+}
+
+int Arr::size() const
+{
+    return e != NULL ? e->size() : 0;
+}
+Value* Arr::get(int i) const
+{
+    if(e == NULL || i < 0 || i >= e->size())
+        return NULL;
+    return (*e)[i];
+}
+void Elements::write(Writer &writer) const
+{
+    List<Value>::writeList(writer);
+}
+
+// Handler that builds the tree of Value nodes in an arena
+class TreeBuilder
+{
+public:
+  void start(Arena*, int duplicates = Members::LAST_WINS);
+
+  Value* getRoot() const
+  {
+    return root;
+  }
+
+  // Move the children of the innermost open container to out and drop
+  // the container, which is being parsed in pieces
+  void takeChildren(vector<Value*>& out)
+  {
+    size_t base = frames.back().base;
+
+    frames.pop_back();
+    out.assign(children.begin() + base, children.end());
+    children.resize(base);
+  }
+
+  bool startObject()
+  {
+    frames.push_back(Frame(true, children.size()));
+    return true;
+  }
+
+  bool key(string_view s)
+  {
+    frames.back().key = quoted(s);
+    return true;
+  }
+
+  bool endObject(int);
+
+  bool startArray()
+  {
+    frames.push_back(Frame(false, children.size()));
+    return true;
+  }
+
+  bool endArray(int);
+
+  bool string(string_view s)
+  {
+    return scalar(Token::STRING, quoted(s));
+  }
+
+  bool number(string_view s)
+  {
+    return scalar(Token::NUMBER, s);
+  }
+
+  bool boolean(bool b)
+  {
+    return b ? scalar(Token::TRUE, "true") : scalar(Token::FALSE, "false");
+  }
+
+  bool null()
+  {
+    return scalar(Token::NULL_, "null");
+  }
+
+private:
+  struct Frame
+  {
+    bool object; // object or array
+    size_t base; // first child in children
+    string_view key; // key of the member being parsed
+
+    Frame(bool object, size_t base):
+      object(object),
+      base(base)
+    {
+      // do nothing
+    }
+  };
+
+  Arena* arena; // storage of the tree being built
+  int duplicates; // policy for repeated member keys
+  vector<Frame> frames; // open containers
+  vector<Value*> children; // children of the open containers
+  Value* root;
+
+  bool scalar(int, string_view);
+  void complete(Value*);
+
+  // The tree keeps strings with their quotes, which the reader strips
+  static string_view quoted(string_view s)
+  {
+    return string_view(s.data() - 1, s.size() + 2);
+  }
+
+}; // TreeBuilder
+
+void
+TreeBuilder::start(Arena* arena, int duplicates)
+{
+  this->arena = arena;
+  this->duplicates = duplicates;
+  frames.clear();
+  children.clear();
+  root = 0;
+}
+
+inline bool
+TreeBuilder::scalar(int type, string_view lexeme)
+{
+  Value* v = new (*arena) Value();
+
+  Stats::node();
+  v->q = type;
+  v->lexeme = lexeme;
+  complete(v);
+  return true;
+}
+
+bool
+TreeBuilder::endObject(int n)
+{
+  Frame f = frames.back();
+  Value* v = new (*arena) Value();
+  Members* m = 0;
+
+  Stats::node();
+  frames.pop_back();
+  if (n > 0)
+  {
+    m = new (*arena) Members(arena, duplicates);
+    m->assign(&children[f.base], n);
+    children.resize(f.base);
+    if (duplicates == Members::REJECT && m->hasDuplicates())
+      return false;
+  }
+  v->o = m != 0 ? new (*arena) Obj(m) : new (*arena) Obj();
+  complete(v);
+  return true;
+}
+
+bool
+TreeBuilder::endArray(int n)
+{
+  Frame f = frames.back();
+  Value* v = new (*arena) Value();
+  Elements* e = 0;
+
+  Stats::node();
+  frames.pop_back();
+  if (n > 0)
+  {
+    e = new (*arena) Elements(arena);
+    e->assign(&children[f.base], n);
+    children.resize(f.base);
+  }
+  v->a = e != 0 ? new (*arena) Arr(e) : new (*arena) Arr();
+  complete(v);
+  return true;
+}
+
+// A value is complete: add it to the open container, or make it the root
+inline void
+TreeBuilder::complete(Value* v)
+{
+  if (frames.empty())
+  {
+    root = v;
+    return;
+  }
+  if (frames.back().object)
+  {
+    v->q = 10;
+    v->st = frames.back().key;
+  }
+  children.push_back(v);
+}
+
+// Handler that appends to a tape
+class TapeBuilder
+{
+public:
+  void start(Tape* tape)
+  {
+    this->tape = tape;
+    open.clear();
+  }
+
+  bool startObject()
+  {
+    open.push_back(tape->append(Tape::START_OBJECT));
+    return true;
+  }
+
+  bool key(string_view s)
+  {
+    tape->appendString(Tape::STRING, s);
+    return true;
+  }
+
+  bool endObject(int n)
+  {
+    tape->closeContainer(open.back(), Tape::END_OBJECT, n);
+    open.pop_back();
+    return true;
+  }
+
+  bool startArray()
+  {
+    open.push_back(tape->append(Tape::START_ARRAY));
+    return true;
+  }
+
+  bool endArray(int n)
+  {
+    tape->closeContainer(open.back(), Tape::END_ARRAY, n);
+    open.pop_back();
+    return true;
+  }
+
+  bool string(string_view s)
+  {
+    tape->appendString(Tape::STRING, s);
+    return true;
+  }
+
+  bool number(string_view s)
+  {
+    tape->appendString(Tape::NUMBER, s);
+    return true;
+  }
+
+  bool boolean(bool b)
+  {
+    tape->append(b ? Tape::TRUE : Tape::FALSE);
+    return true;
+  }
+
+  bool null()
+  {
+    tape->append(Tape::NULL_);
+    return true;
+  }
+
+private:
+  Tape* tape; // tape being built
+  vector<size_t> open; // start words of the open containers
+
+}; // TapeBuilder
+
+// Outcome of a parse, for callers that would rather not catch
+// ParseError, such as services that must go on after a bad request
+class ParseResult
+{
+public:
+  JsonPtr json; // the document, or 0 if the input is malformed
+  ParseError error; // what is wrong with the input, when json is 0
+
+  ParseResult():
+    error(0, 0)
+  {
+    // do nothing
+  }
+
+  bool ok() const
+  {
+    return json != 0;
+  }
+
+}; // ParseResult
+
+// A Parser may parse any number of documents one after the other. It
+// keeps its structural index, its stacks and, once the caller lets go
+// of the previous document, its arena, so that they are already large
+// enough and in the cache for the next one.
+class Parser
+{
+public:
+  Json* parse(const char*);
+  Json* parse(Input*, Arena* = 0);
+  bool parse(Input*, ParseResult&, Arena* = 0); // does not throw
+  Tape* parseTape(Input*, Tape* = 0);
+  void setDuplicateKeys(int); // a Members::DuplicateKeys
+  void setValidateUtf8(bool); // off by default
+  void setMaxDepth(size_t); // Reader::DEFAULT_MAX_DEPTH by default
+  Parser();
+private:
+  Reader reader;
+  TreeBuilder tree;
+  TapeBuilder tapeBuilder;
+  ArenaPtr pool; // arena reused when the caller gives none
+  int duplicates; // policy for repeated member keys
+
+}; // Parser
+
+//Construtor do Parser, inicializa com todos os valores em zero
+Parser::Parser()
+{
+  duplicates = Members::LAST_WINS;
+}
+
+void
+Parser::setDuplicateKeys(int policy)
+{
+  duplicates = policy;
+}
+
+void
+Parser::setValidateUtf8(bool validate)
+{
+  reader.setValidateUtf8(validate);
+}
+
+void
+Parser::setMaxDepth(size_t depth)
+{
+  reader.setMaxDepth(depth);
+}
+
+Json*
+Parser::parse(const char* input)
+{
+  InputPtr source = new Input(input);
+
+  return parse(source);
+}
+
+Json*
+Parser::parse(Input* source, Arena* arena)
+{
+  if (arena == 0)
+  {
+    // Rewind the previous document's arena once nobody else uses it
+    if (pool == 0 || pool->getNumberOfUses() > 1)
+      pool = new Arena();
+    else
+      pool->reset();
+    arena = pool;
+  }
+  tree.start(arena, duplicates);
+  reader.parse(source, tree);
+  Json* J = new Json();
+  J->v = tree.getRoot();
+  J->input = source;
+  J->arena = arena;
+  return J;
+}
+
+bool
+Parser::parse(Input* source, ParseResult& result, Arena* arena)
+{
+  // Let go of the previous document first, so that its arena is free
+  // to be reused
+  result.json = 0;
+  try
+  {
+    result.json = parse(source, arena);
+    return true;
+  }
+  catch (const ParseError& e)
+  {
+    result.error = e;
+    return false;
+  }
+}
+
+// Parse into a tape; the words of t, if given, are reused
+Tape*
+Parser::parseTape(Input* source, Tape* t)
+{
+  if (t == 0)
+    t = new Tape();
+  else
+    t->clear();
+  tapeBuilder.start(t);
+
+  size_t root = t->append(Tape::ROOT);
+
+  reader.parse(source, tapeBuilder);
+  t->closeContainer(root, Tape::ROOT, 1);
+  return t;
+}
+#endif
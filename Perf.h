@@ -0,0 +1,214 @@
+#ifndef __Perf_h
+#define __Perf_h
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+Hardware counters
+=================
+The processor's own counts of what a piece of code costs: cycles,
+instructions, branch misses, L1 data cache and last level cache misses,
+plus the page faults counted by the kernel. They tell a lexer held up by
+mispredicted branches from a tree walk held up by cache misses, which
+the time alone does not.
+
+The events are opened with perf_event_open as one group, so that all
+of them are read at once with a single read() and count over the same
+intervals. Only the calling thread is counted, in user mode, which is
+allowed with the default perf_event_paranoid setting. An event the
+processor, the kernel or a container does not provide is left out, and
+available() says which ones are counting; with none of them, as
+outside Linux, read() gives zeros and the caller reports the counters
+as unavailable.
+
+When there are more groups than hardware counters, the kernel shares
+them out and a group counts only part of the time it is enabled. A
+reading is therefore kept raw, with the two times, and only the counts
+between two readings are scaled up, by the ratio of the time enabled to
+the time running over that interval: scaling each reading by the ratio
+since the counters were opened would weigh the interval by the history
+before it, and the difference of two such readings could even be
+negative.
+*/
+
+class PerfCounters
+{
+public:
+  enum Event
+  {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1_MISSES, // L1 data cache read misses
+    LLC_MISSES, // last level cache misses
+    PAGE_FAULTS,
+    NUMBER_OF_EVENTS
+  }; // Event
+
+  // Constructor; nothing is opened until open()
+  PerfCounters():
+    leader(-1),
+    opened(false),
+    count(0)
+  {
+    for (int i = 0; i < NUMBER_OF_EVENTS; i++)
+      fds[i] = -1;
+  }
+
+  // Destructor
+  ~PerfCounters()
+  {
+    for (int i = 0; i < NUMBER_OF_EVENTS; i++)
+      if (fds[i] >= 0)
+        close(fds[i]);
+  }
+
+  // Open and start the counters of the calling thread, once. Returns
+  // whether any is counting.
+  bool open();
+
+  bool available(int event) const
+  {
+    return fds[event] >= 0;
+  }
+
+  bool any() const
+  {
+    return count > 0;
+  }
+
+  // Raw counts of the group since it was opened, with the time it was
+  // enabled and the time it was running, in nanoseconds
+  struct Reading
+  {
+    uint64_t values[NUMBER_OF_EVENTS]; // 0 for the events not available
+    uint64_t enabled;
+    uint64_t running;
+  };
+
+  // Current counts
+  void read(Reading&) const;
+
+  // Add to totals the counts from begin to end, scaled up to the whole
+  // interval if the group was not running all of it
+  static void add(const Reading& begin, const Reading& end,
+    uint64_t totals[NUMBER_OF_EVENTS]);
+
+  static const char* getName(int event)
+  {
+    static const char* const names[] =
+    {
+      "cycles",
+      "instructions",
+      "branch_misses",
+      "l1d_misses",
+      "llc_misses",
+      "page_faults"
+    };
+
+    return names[event];
+  }
+
+private:
+  int fds[NUMBER_OF_EVENTS];
+  int leader; // descriptor of the group
+  bool opened;
+  int count; // events in the group, in the order of fds
+
+  PerfCounters(const PerfCounters&);
+  PerfCounters& operator =(const PerfCounters&);
+
+}; // PerfCounters
+
+bool
+PerfCounters::open()
+{
+  if (opened)
+    return any();
+  opened = true;
+#ifdef __linux__
+  static const uint32_t types[] =
+  {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_SOFTWARE
+  };
+  static const uint64_t configs[] =
+  {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+      PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_SW_PAGE_FAULTS
+  };
+
+  for (int i = 0; i < NUMBER_OF_EVENTS; i++)
+  {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[i];
+    attr.config = configs[i];
+    attr.disabled = leader < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    if (fds[i] < 0)
+      continue;
+    if (leader < 0)
+      leader = fds[i];
+    count++;
+  }
+  if (leader >= 0)
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  return any();
+}
+
+void
+PerfCounters::read(Reading& r) const
+{
+  // nr, time enabled, time running, then a value per event
+  uint64_t data[3 + NUMBER_OF_EVENTS];
+
+  memset(&r, 0, sizeof(r));
+  if (leader < 0 || ::read(leader, data, sizeof(data)) < (ssize_t)(3 * sizeof(uint64_t)))
+    return;
+  r.enabled = data[1];
+  r.running = data[2];
+  for (int i = 0, j = 3; i < NUMBER_OF_EVENTS && j < 3 + (int)data[0]; i++)
+    if (fds[i] >= 0)
+      r.values[i] = data[j++];
+}
+
+void
+PerfCounters::add(const Reading& begin, const Reading& end,
+  uint64_t totals[NUMBER_OF_EVENTS])
+{
+  uint64_t running = end.running - begin.running;
+
+  // Not running at all in the interval: nothing was counted
+  if (running == 0)
+    return;
+
+  double scale = (double)(end.enabled - begin.enabled) / running;
+
+  for (int i = 0; i < NUMBER_OF_EVENTS; i++)
+    totals[i] += (uint64_t)((end.values[i] - begin.values[i]) * scale + 0.5);
+}
+
+#endif // __Perf_h
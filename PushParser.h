@@ -0,0 +1,526 @@
+#ifndef __PushParser_h
+#define __PushParser_h
+#include "Parser.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+Push parser
+===========
+Incremental parser for input that arrives in pieces. feed() takes the
+next chunk, which may end anywhere, even inside a string or a number,
+and returns NEED_MORE, DONE or ERROR. The grammar state is kept in an
+explicit stack of open containers instead of on the call stack, and a
+token split between chunks is collected in a small pending buffer.
+Values are handed to a TreeBuilder, as the Reader does, after their
+lexemes are copied into the document's arena, since the chunks are not
+kept. finish() marks the end of the input, which completes a number at
+the end of the document.
+
+Errors are reported with the same ParseError as the Parser's, line and
+column included: the lines are counted in the whitespace between
+tokens, since no token can hold a newline.
+
+With setValidateUtf8(), each string is checked once it is complete,
+with its pieces from earlier chunks, and so is a number or literal found
+to be wrong; outside strings a byte that is not ASCII starts no token
+anyway. As with the Lexer, an invalid sequence in a token is reported
+as a UTF-8 error at its offset, before anything else wrong with the
+token. The Lexer checks the whole input first, though, so it reports
+one even past an earlier error that stops the push parser.
+*/
+
+class PushParser
+{
+public:
+  enum Status
+  {
+    NEED_MORE,
+    DONE,
+    ERROR
+  }; // Status
+
+  PushParser();
+
+  int feed(const char*, size_t);
+  int finish();
+
+  // Document parsed so far; valid once DONE is returned
+  Json* getDocument();
+
+  // What is wrong with the input, once ERROR is returned
+  const ParseError& getError() const
+  {
+    return error;
+  }
+
+  // Document or error, as Parser::parse() gives them, once finish()
+  // has returned
+  void getResult(ParseResult&);
+
+  // Get ready for the next document, keeping the buffers
+  void reset();
+
+  // Whether the strings must be valid UTF-8, as for the Parser; kept
+  // by reset()
+  void setValidateUtf8(bool validate)
+  {
+    utf8 = validate;
+  }
+
+  // Most containers that may be open at once, as for the Reader
+  void setMaxDepth(size_t depth)
+  {
+    maxDepth = depth;
+  }
+
+private:
+  enum State
+  {
+    VALUE, // a value
+    FIRST_ELEMENT, // a value or ']'
+    FIRST_MEMBER, // a key or '}'
+    KEY, // a key
+    COLON, // ':'
+    NEXT, // ',' or the end of the open container
+    END // nothing but whitespace
+  }; // State
+
+  enum Partial
+  {
+    NONE,
+    STRING, // inside a string
+    SCALAR // inside a number, true, false or null
+  }; // Partial
+
+  struct Frame
+  {
+    bool object; // object or array
+    int count; // members or elements so far
+
+    Frame(bool object):
+      object(object),
+      count(0)
+    {
+      // do nothing
+    }
+  };
+
+  int state;
+  int status;
+  int partial; // token left unfinished by the previous chunk
+  bool escape; // partial string ends with a backslash
+  string pending; // beginning of the unfinished token
+  vector<Frame> frames; // open containers
+  size_t maxDepth;
+  bool utf8; // whether to validate UTF-8
+  TreeBuilder tree;
+  ArenaPtr arena;
+  size_t offset; // bytes fed before the current chunk
+  int lineNumber; // line of the next byte, counted from 1
+  size_t lineStart; // offset of the first byte of that line
+  int refusal; // why token() returned false
+  ParseError error;
+
+  bool token(int, string_view);
+  bool scalar(string_view, size_t);
+  bool close();
+  bool complete(bool);
+  string_view copy(string_view);
+  int fail(size_t, int);
+  int failString(const char*, const char*, size_t);
+  bool badUtf8(string_view, size_t);
+
+  bool accepted(bool ok)
+  {
+    if (!ok)
+      refusal = ParseError::REJECTED;
+    return ok;
+  }
+
+  // Contents of a string lexeme, which the tree builder expects
+  static string_view contents(string_view s)
+  {
+    return s.substr(1, s.size() - 2);
+  }
+
+}; // PushParser
+
+PushParser::PushParser():
+  maxDepth(Reader::DEFAULT_MAX_DEPTH),
+  utf8(false),
+  error(0, 0)
+{
+  reset();
+}
+
+void
+PushParser::reset()
+{
+  state = VALUE;
+  status = NEED_MORE;
+  partial = NONE;
+  escape = false;
+  pending.clear();
+  frames.clear();
+  // Rewind the previous document's arena once nobody else uses it
+  if (arena == 0 || arena->getNumberOfUses() > 1)
+    arena = new Arena();
+  else
+    arena->reset();
+  tree.start(arena);
+  offset = 0;
+  lineNumber = 1;
+  lineStart = 0;
+  error = ParseError(0, 0);
+}
+
+// Error at offset at of the input, which is on the current line
+int
+PushParser::fail(size_t at, int code)
+{
+  error = ParseError(lineNumber, at, code, at - lineStart + 1);
+  return status = ERROR;
+}
+
+// Whether text, at offset at of the input, has an invalid UTF-8
+// sequence, which is then the error, when UTF-8 is validated
+bool
+PushParser::badUtf8(string_view text, size_t at)
+{
+  if (!utf8)
+    return false;
+
+  size_t k = Utf8::find(text.data(), text.size());
+
+  if (k == text.size())
+    return false;
+
+  // A string may hold a newline before the sequence, which is then an
+  // error too, but a later one
+  ParseError e = ParseError::at(text.data(), text.data() + k, ParseError::UTF8);
+
+  fail(at + k, ParseError::UTF8);
+  if (e.lineNumber > 1)
+  {
+    error.lineNumber += e.lineNumber - 1;
+    error.column = e.column;
+  }
+  return true;
+}
+
+// Error at the byte p, at offset at of the input, where Escape::scan()
+// stopped in a string that ends at end, as the Lexer tells it
+int
+PushParser::failString(const char* p, const char* end, size_t at)
+{
+  return fail(at, p == end ? ParseError::UNTERMINATED_STRING :
+    (unsigned char)*p < 0x20 ? ParseError::CONTROL_CHARACTER :
+    ParseError::INVALID_ESCAPE);
+}
+
+int
+PushParser::feed(const char* chunk, size_t size)
+{
+  if (status == ERROR)
+    return status;
+
+  const char* p = chunk;
+  const char* end = chunk + size;
+  const char* begin = chunk; // start of the current token
+  Stats::Timer timer(Stats::PARSE);
+
+  Stats::scanned(size);
+  while (p < end)
+  {
+    if (partial == STRING)
+    {
+      // Find the closing quote; the escapes are checked once the whole
+      // string is at hand, since one may be split between chunks
+      for (; p < end; p++)
+        if (escape)
+          escape = false;
+        else if (*p == 92)
+          escape = true;
+        else if (*p == 34)
+          break;
+      if (p == end)
+        break;
+      ++p;
+
+      string_view text(begin, p - begin);
+
+      if (!pending.empty())
+        text = pending.append(text);
+
+      const char* q = text.data() + 1;
+      size_t start = offset + (p - chunk) - text.size();
+
+      if (badUtf8(text, start))
+        return status;
+      if (!Escape::scan(q, text.data() + text.size()))
+        return failString(q, text.data() + text.size(),
+          start + (q - text.data()));
+      if (!token(Token::STRING, text))
+        return fail(start, refusal);
+      partial = NONE;
+      pending.clear();
+      continue;
+    }
+    if (partial == SCALAR)
+    {
+      while (p < end && !CharClass::isDelimiter(*p))
+        ++p;
+      if (p == end)
+        break;
+
+      string_view text(begin, p - begin);
+
+      if (!pending.empty())
+        text = pending.append(text);
+      if (!scalar(text, offset + (p - chunk) - text.size()))
+        return status;
+      partial = NONE;
+      pending.clear();
+      continue;
+    }
+
+    char c = *p;
+
+    switch (c)
+    {
+      case '\n':
+        ++lineNumber;
+        lineStart = offset + (p - chunk) + 1;
+        // fall through
+      case ' ':
+      case '\t':
+      case '\r':
+        ++p;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        if (!token(c, string_view(p, 1)))
+          return fail(offset + (p - chunk), refusal);
+        ++p;
+        break;
+      case '"':
+        partial = STRING;
+        begin = p++;
+        break;
+      default:
+        partial = SCALAR;
+        begin = p;
+    }
+  }
+  if (partial != NONE)
+    pending.append(begin, end - begin);
+  offset += size;
+  return status = state == END ? DONE : NEED_MORE;
+}
+
+int
+PushParser::finish()
+{
+  if (status == ERROR)
+    return status;
+  if (partial == STRING)
+  {
+    const char* p = pending.data() + 1;
+    const char* end = pending.data() + pending.size();
+
+    if (badUtf8(pending, offset - pending.size()))
+      return status;
+    Escape::scan(p, end);
+    return failString(p, end, offset - (end - p));
+  }
+  if (partial == SCALAR)
+  {
+    if (!scalar(pending, offset - pending.size()))
+      return status;
+    partial = NONE;
+    pending.clear();
+  }
+  if (state != END)
+    return fail(offset, ParseError::UNEXPECTED_END);
+  return status = DONE;
+}
+
+void
+PushParser::getResult(ParseResult& result)
+{
+  result.json = getDocument();
+  result.error = error;
+}
+
+Json*
+PushParser::getDocument()
+{
+  if (status != DONE)
+    return 0;
+
+  Json* j = new Json();
+
+  j->v = tree.getRoot();
+  j->arena = arena;
+  return j;
+}
+
+// Classify a complete number, true, false or null, which starts at
+// offset at of the input; false, with the error, if it is none
+bool
+PushParser::scalar(string_view text, size_t at)
+{
+  int type = Token::NUMBER;
+  size_t end;
+
+  switch (text[0])
+  {
+    case 't':
+      type = Token::TRUE;
+      break;
+    case 'f':
+      type = Token::FALSE;
+      break;
+    case 'n':
+      type = Token::NULL_;
+      break;
+  }
+  if (type != Token::NUMBER)
+  {
+    string_view literal = type == Token::TRUE ? "true" :
+      type == Token::FALSE ? "false" : "null";
+
+    // A misspelled literal, or one followed by more than a delimiter
+    if (text != literal)
+    {
+      if (badUtf8(text, at))
+        return false;
+      end = text.compare(0, literal.size(), literal) == 0 ? literal.size() : 0;
+      fail(at + end, ParseError::INVALID_LITERAL);
+      return false;
+    }
+  }
+  else if (!Number::isValid(text, end))
+  {
+    if (badUtf8(text, at))
+      return false;
+    fail(at + end, text[0] == '-' || CharClass::isDigit(text[0]) ?
+      ParseError::INVALID_NUMBER : ParseError::INVALID_CHARACTER);
+    return false;
+  }
+  if (!token(type, text))
+  {
+    fail(at, refusal);
+    return false;
+  }
+  return true;
+}
+
+// Advance the grammar by one token
+bool
+PushParser::token(int type, string_view text)
+{
+  Stats::token(type);
+  refusal = state == END ? ParseError::TRAILING_CONTENT : ParseError::SYNTAX;
+  switch (state)
+  {
+    case COLON:
+      if (type != ':')
+        return false;
+      state = VALUE;
+      return true;
+    case FIRST_MEMBER:
+      if (type == '}')
+        return close();
+      // fall through
+    case KEY:
+      if (type != Token::STRING)
+        return false;
+      state = COLON;
+      return accepted(tree.key(contents(copy(text))));
+    case NEXT:
+      if (type == ',')
+      {
+        state = frames.back().object ? KEY : VALUE;
+        return true;
+      }
+      if (type == (frames.back().object ? '}' : ']'))
+        return close();
+      return false;
+    case FIRST_ELEMENT:
+      if (type == ']')
+        return close();
+      // fall through
+    case VALUE:
+      if ((type == '{' || type == '[') && frames.size() >= maxDepth)
+      {
+        refusal = ParseError::TOO_DEEP;
+        return false;
+      }
+      switch (type)
+      {
+        case '{':
+          frames.push_back(Frame(true));
+          Stats::depth(frames.size());
+          state = FIRST_MEMBER;
+          return accepted(tree.startObject());
+        case '[':
+          frames.push_back(Frame(false));
+          Stats::depth(frames.size());
+          state = FIRST_ELEMENT;
+          return accepted(tree.startArray());
+        case Token::STRING:
+          return complete(tree.string(contents(copy(text))));
+        case Token::NUMBER:
+          return complete(tree.number(copy(text)));
+        case Token::TRUE:
+          return complete(tree.boolean(true));
+        case Token::FALSE:
+          return complete(tree.boolean(false));
+        case Token::NULL_:
+          return complete(tree.null());
+      }
+  }
+  return false;
+}
+
+// Close the innermost container and hand it to its parent
+bool
+PushParser::close()
+{
+  Frame f = frames.back();
+
+  frames.pop_back();
+  return complete(f.object ? tree.endObject(f.count) : tree.endArray(f.count));
+}
+
+// A value is complete: count it in the open container, if any
+bool
+PushParser::complete(bool ok)
+{
+  if (frames.empty())
+    state = END;
+  else
+  {
+    frames.back().count++;
+    state = NEXT;
+  }
+  return accepted(ok);
+}
+
+string_view
+PushParser::copy(string_view text)
+{
+  char* p = (char*)arena->allocate(text.size(), 1);
+
+  memcpy(p, text.data(), text.size());
+  return string_view(p, text.size());
+}
+
+#endif // __PushParser_h
@@ -0,0 +1,356 @@
+/*
+Grammar
+=================
+Json:
+  Value EOF
+;
+
+Value:
+  Object
+| Array
+| STRING
+| NUMBER
+| TRUE
+| FALSE
+| NULL
+;
+
+Object:
+  '{' MembersOpt '}'
+;
+
+MembersOpt:
+  Members
+| // empty
+;
+
+Members:
+  Pair M_
+;
+
+M_:
+  ',' Pair M_
+| // empty
+;
+
+Pair:
+  STRING ':' Value
+;
+
+Array:
+  '[' ElementsOpt ']'
+;
+
+ElementsOpt:
+  Elements
+| // empty
+;
+
+Elements:
+  Value E_
+;
+
+E_:
+  ',' Value E_
+| // empty
+;
+
+LL(1) grammar
+=============
+Json: Value EOF;
+Value: Object | Array | STRING | NUMBER | TRUE | FALSE | NULL;
+Object: '{' MembersOpt '}';
+MembersOpt: Members | ;
+Members: Pair M_;
+M_: ',' Pair M_ | ;
+Pair: STRING ':' Value;
+Array: '[' ElementsOpt ']';
+ElementsOpt: Elements | ;
+Elements: Value E_;
+E_: ',' Value E_ | ;
+
+Syntax diagrams
+===============
+Json: Value EOF;
+Value: Object | Array | STRING | NUMBER | TRUE | FALSE | NULL;
+Object: "{" Members? "}";
+Members: Pair ("," Pair)*;
+Pair: STRING ":" Value;
+Array: "[" Elements? "]";
+Elements: Value ("," Value)*;
+
+First
+=====
+FIRST(Json)={ '{', '[', STRING, NUMBER, TRUE, FALSE, NULL }
+FIRST(Value)={ '{', '[', STRING, NUMBER, TRUE, FALSE, NULL }
+FIRST(Object)={ '{' }
+FIRST(MembersOpt)={ STRING, empty}
+FIRST(Members)={ STRING }
+FIRST(M_)={ ',', empty }
+FIRST(Pair)={ STRING }
+FIRST(Array)={ '[' }
+FIRST(ElementsOpt)={ '{', '[', STRING, NUMBER, TRUE, FALSE, NULL, empty}
+FIRST(Elements)={ '{', '[', STRING, NUMBER, TRUE, FALSE, NULL }
+FIRST(E_)={ ',', empty }
+*/
+
+#ifndef __Reader_h
+#define __Reader_h
+#include "Lexer.h"
+#include <vector>
+
+/*
+Reader
+======
+Parser of the grammar above that builds nothing itself: each value is
+reported to a handler as it is recognized. The handler is a template
+parameter, so its calls are resolved at compile time and usually
+inlined. A handler provides
+
+  bool startObject();
+  bool key(string_view); // member key, without the quotes
+  bool endObject(int); // number of members
+  bool startArray();
+  bool endArray(int); // number of elements
+  bool string(string_view); // contents, without the quotes
+  bool number(string_view); // lexeme
+  bool boolean(bool);
+  bool null();
+
+Strings are reported as they appear in the input, escapes included.
+Returning false from any of them stops the parse with an error.
+
+The rules for Object and Array are not followed by recursive calls:
+the open containers are kept in a stack of frames, so that a value
+nested a thousand levels deep costs a frame of a few bytes rather than
+several call frames, and one loop goes through a long array without a
+call per element. The stack keeps its room from one parse to the next,
+and a container deeper than the maximum depth is an error rather than
+a stack overflow.
+*/
+
+class Reader: public Lexer
+{
+public:
+  enum { DEFAULT_MAX_DEPTH = 1024 };
+
+  Reader()
+  {
+    setMaxDepth(DEFAULT_MAX_DEPTH);
+  }
+
+  template <typename Handler> void parse(Input*, Handler&);
+
+  // Parse the members (or the elements) of a container that lie between
+  // first and last, as when the container is cut into pieces at its
+  // commas; reported without startObject() and endObject()
+  template <typename Handler>
+  int parseRange(Input*, const char*, const char*, bool, Handler&);
+
+  // Most containers that may be open at once; the root counts as one
+  void setMaxDepth(size_t depth)
+  {
+    maxDepth = depth;
+    stack.reserve(depth < DEFAULT_MAX_DEPTH ? depth : (size_t)DEFAULT_MAX_DEPTH);
+  }
+
+private:
+  struct Frame
+  {
+    bool object; // object or array
+    int count; // members or elements so far
+
+    Frame(bool object):
+      object(object),
+      count(0)
+    {
+      // do nothing
+    }
+  };
+
+  vector<Frame> stack; // open containers
+  size_t maxDepth;
+
+  template <typename Handler> int values(Handler&, size_t);
+  template <typename Handler> void scalar(Handler&);
+  template <typename Handler> void key(Handler&);
+  template <typename Handler> void close(Handler&);
+
+  void open(bool object)
+  {
+    if (stack.size() >= maxDepth)
+      error(ParseError::TOO_DEEP, lookahead.lexeme.data());
+    stack.push_back(Frame(object));
+    Stats::depth(stack.size());
+  }
+
+  // Error when the handler refuses the lookahead token
+  void rejected()
+  {
+    error(ParseError::REJECTED, lookahead.type == Token::EOF_ ?
+      end : lookahead.lexeme.data());
+  }
+
+  // Contents of the string token in lookahead
+  string_view contents() const
+  {
+    return lookahead.lexeme.substr(1, lookahead.lexeme.size() - 2);
+  }
+
+}; // Reader
+
+template <typename Handler>
+void
+Reader::parse(Input* source, Handler& handler)
+{
+  start(source);
+  stack.clear();
+
+  Stats::Timer timer(Stats::PARSE);
+
+  values(handler, 0);
+  if (lookahead.type != Token::EOF_)
+    error(ParseError::TRAILING_CONTENT, lookahead.lexeme.data());
+}
+
+template <typename Handler>
+int
+Reader::parseRange(Input* source, const char* first, const char* last,
+  bool object, Handler& handler)
+{
+  start(source, first, last);
+  stack.clear();
+
+  Stats::Timer timer(Stats::PARSE);
+
+  open(object);
+
+  int n = values(handler, 1);
+
+  if (lookahead.type != Token::EOF_)
+    unexpected();
+  return n;
+}
+
+// Parse values until the stack is back to bottom frames: the root value
+// when bottom is 0, or the members or elements of the open container
+// when it is 1, whose number is returned
+template <typename Handler>
+int
+Reader::values(Handler& handler, size_t bottom)
+{
+  if (bottom > 0 && stack.back().object)
+    goto member;
+
+value:
+  switch (lookahead.type)
+  {
+    case '{':
+      open(true);
+      if (!handler.startObject())
+        rejected();
+      advance();
+      if (lookahead.type != '}')
+        goto member;
+      close(handler);
+      break;
+    case '[':
+      open(false);
+      if (!handler.startArray())
+        rejected();
+      advance();
+      if (lookahead.type != ']')
+        goto value;
+      close(handler);
+      break;
+    default:
+      scalar(handler);
+  }
+
+  // A value is complete: count it, and close the containers that end
+  // with it
+  for (;;)
+  {
+    if (stack.empty())
+      return 0;
+
+    Frame& f = stack.back();
+
+    f.count++;
+    if (lookahead.type == ',')
+    {
+      advance();
+      if (f.object)
+        goto member;
+      goto value;
+    }
+    if (stack.size() == bottom)
+      return f.count;
+    close(handler);
+  }
+
+member:
+  key(handler);
+  goto value;
+}
+
+template <typename Handler>
+inline void
+Reader::scalar(Handler& handler)
+{
+  bool ok = false;
+
+  switch (lookahead.type)
+  {
+    case Token::STRING:
+      ok = handler.string(contents());
+      break;
+    case Token::NUMBER:
+      ok = handler.number(lookahead.lexeme);
+      break;
+    case Token::TRUE:
+      ok = handler.boolean(true);
+      break;
+    case Token::FALSE:
+      ok = handler.boolean(false);
+      break;
+    case Token::NULL_:
+      ok = handler.null();
+      break;
+    default:
+      unexpected();
+  }
+  if (!ok)
+    rejected();
+  advance();
+}
+
+// The key and the colon of a member
+template <typename Handler>
+inline void
+Reader::key(Handler& handler)
+{
+  if (lookahead.type != Token::STRING)
+    unexpected();
+  if (!handler.key(contents()))
+    rejected();
+  advance();
+  match(':');
+}
+
+// End the innermost container, whose closing bracket must be next
+template <typename Handler>
+inline void
+Reader::close(Handler& handler)
+{
+  Frame f = stack.back();
+
+  if (lookahead.type != (f.object ? '}' : ']'))
+    unexpected();
+  if (!(f.object ? handler.endObject(f.count) : handler.endArray(f.count)))
+    rejected();
+  stack.pop_back();
+  advance();
+}
+
+#endif // __Reader_h
@@ -0,0 +1,172 @@
+#ifndef __Serializer_h
+#define __Serializer_h
+#include "Parser.h"
+#include <string>
+#include <string_view>
+
+/*
+Serializer
+==========
+Writes a tree as JSON into a Writer's buffer, compact or pretty printed
+with a given number of spaces per level. Numbers, literals and strings
+are copied from their lexemes, which the parser has already checked,
+so a document is written in about the time it takes to walk the tree;
+only numbers set by a program are formatted from their values.
+With canonical strings, escapes are decoded and strings written again
+with only the escapes JSON requires, so "\u00e9" becomes "é" and "\/"
+becomes "/". Text that is not in a tree is written with writeString(),
+which escapes it a block at a time.
+*/
+
+class Serializer
+{
+public:
+  // Constructor; indent 0 writes compact JSON
+  Serializer(Writer& writer, int indent = 0):
+    writer(writer),
+    indent(indent),
+    level(0),
+    canonical(false)
+  {
+    // do nothing
+  }
+
+  void setCanonicalStrings(bool canonical)
+  {
+    this->canonical = canonical;
+  }
+
+  // Write a document followed by a line end
+  void write(const Json*);
+
+  // Write a value, at the current level
+  void write(const Value*);
+
+  // Write text as a string: quoted, with the characters JSON does not
+  // allow escaped
+  void writeString(std::string_view);
+
+private:
+  Writer& writer;
+  int indent; // spaces per level
+  int level;
+  bool canonical; // whether to rewrite the escapes of strings
+  std::string text; // a string being rewritten
+
+  void object(const Members*);
+  void array(const Elements*);
+  void string(std::string_view);
+
+  // Line end and indentation before a member or element
+  void newLine()
+  {
+    if (indent > 0)
+    {
+      writer.write('\n');
+      writer.writeSpaces(level * indent);
+    }
+  }
+
+}; // Serializer
+
+void
+Serializer::write(const Json* j)
+{
+  write(j->v);
+  writer.write('\n');
+}
+
+void
+Serializer::write(const Value* v)
+{
+  if (v->o != 0)
+    object(v->o->m);
+  else if (v->a != 0)
+    array(v->a->e);
+  else if (!v->lexeme.empty() && v->lexeme[0] == '"')
+    string(v->lexeme);
+  else if (!v->lexeme.empty())
+    writer.write(v->lexeme);
+  else
+  {
+    char text[Number::MAX_LENGTH];
+
+    writer.write(text, v->formatNumber(text));
+  }
+}
+
+void
+Serializer::writeString(std::string_view s)
+{
+  writer.write('"');
+  Escape::escape(s, writer);
+  writer.write('"');
+}
+
+void
+Serializer::object(const Members* m)
+{
+  if (m == 0 || m->size() == 0)
+  {
+    writer.write("{}", 2);
+    return;
+  }
+  writer.write('{');
+  level++;
+  for (int i = 0; i < m->size(); i++)
+  {
+    const Value* member = (*m)[i];
+
+    if (i > 0)
+      writer.write(',');
+    newLine();
+    string(member->st);
+    if (indent > 0)
+      writer.write(": ", 2);
+    else
+      writer.write(':');
+    write(member);
+  }
+  level--;
+  newLine();
+  writer.write('}');
+}
+
+void
+Serializer::array(const Elements* e)
+{
+  if (e == 0 || e->size() == 0)
+  {
+    writer.write("[]", 2);
+    return;
+  }
+  writer.write('[');
+  level++;
+  for (int i = 0; i < e->size(); i++)
+  {
+    if (i > 0)
+      writer.write(',');
+    newLine();
+    write((*e)[i]);
+  }
+  level--;
+  newLine();
+  writer.write(']');
+}
+
+// Write a string lexeme, quotes included
+void
+Serializer::string(std::string_view lexeme)
+{
+  std::string_view contents = lexeme.substr(1, lexeme.size() - 2);
+
+  // Without a backslash the contents are already canonical
+  if (!canonical || memchr(contents.data(), '\\', contents.size()) == 0)
+    writer.write(lexeme);
+  else if (Escape::unescape(contents, text))
+    writeString(text);
+  else
+    writer.write(lexeme);
+}
+
+#endif // __Serializer_h
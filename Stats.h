@@ -0,0 +1,369 @@
+#ifndef __Stats_h
+#define __Stats_h
+#include "Perf.h"
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+Statistics
+==========
+Counters kept along the hot paths when the program is compiled with
+JSON_STATS defined (make STATS=1): bytes scanned, tokens of each type,
+tree nodes, bytes placed in arenas, the deepest nesting, and the time
+spent lexing (building the structural index), parsing and writing.
+Without JSON_STATS every hook below is an empty inline function and
+the parsers are compiled exactly as if it were not there.
+
+Each thread counts in its own Stats, with no atomic operations; it is
+a plain structure, so the counters are reached without the call that
+guards a thread-local object with a constructor. What a thread counted
+is added to a common total when the thread ends, so the total seen by
+the main thread after a parallel or NDJSON parse covers its workers
+too, with their times added together.
+
+With profiling on, each phase also reads the hardware counters of its
+thread (Perf.h) where it starts and ends, and the report gives them
+per byte of input and per node of the tree, to tell what bounds each
+phase. The counters are read only at the edges of a phase, never per
+token.
+*/
+
+class Stats
+{
+public:
+  enum Phase
+  {
+    LEX,
+    PARSE,
+    WRITE,
+    NUMBER_OF_PHASES
+  }; // Phase
+
+  uint64_t bytes; // input scanned
+  uint64_t tokens[12]; // by tokenIndex()
+  uint64_t nodes; // values of the trees built
+  uint64_t allocated; // bytes placed in arenas
+  uint64_t maxDepth;
+  double seconds[NUMBER_OF_PHASES];
+  uint64_t events[NUMBER_OF_PHASES][PerfCounters::NUMBER_OF_EVENTS];
+  uint32_t counted; // bit i set if event i could be counted
+
+  void clear()
+  {
+    memset(this, 0, sizeof(*this));
+  }
+
+  void add(const Stats&);
+
+  // Write the statistics to out, as text or as one JSON object
+  void write(FILE* out, bool json) const;
+
+  static bool enabled()
+  {
+#ifdef JSON_STATS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // What this thread has counted, plus what the threads that ended
+  // before have
+  static Stats total();
+
+  // Read the hardware counters in every phase; set before any thread
+  // starts parsing
+  static void setProfiling(bool on)
+  {
+    profiling = on;
+  }
+
+  // Hooks for the parsers
+  static void scanned(size_t n)
+  {
+#ifdef JSON_STATS
+    collector.active = true;
+    local.bytes += n;
+#else
+    (void)n;
+#endif
+  }
+
+  static void token(int type)
+  {
+#ifdef JSON_STATS
+    local.tokens[tokenIndex(type)]++;
+#else
+    (void)type;
+#endif
+  }
+
+  static void node()
+  {
+#ifdef JSON_STATS
+    local.nodes++;
+#endif
+  }
+
+  static void allocate(size_t n)
+  {
+#ifdef JSON_STATS
+    local.allocated += n;
+#else
+    (void)n;
+#endif
+  }
+
+  static void depth(size_t n)
+  {
+#ifdef JSON_STATS
+    if (n > local.maxDepth)
+      local.maxDepth = n;
+#else
+    (void)n;
+#endif
+  }
+
+  // Adds the time from its construction to its destruction to a phase
+  class Timer
+  {
+  public:
+#ifdef JSON_STATS
+    Timer(Phase phase):
+      phase(phase)
+    {
+      collector.active = true;
+      if (profiling)
+        collector.read(begin);
+      start = std::chrono::steady_clock::now();
+    }
+
+    ~Timer()
+    {
+      local.seconds[phase] += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      if (profiling)
+      {
+        PerfCounters::Reading end;
+
+        collector.read(end);
+        PerfCounters::add(begin, end, local.events[phase]);
+      }
+    }
+
+  private:
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+    PerfCounters::Reading begin;
+#else
+    Timer(Phase)
+    {
+      // do nothing
+    }
+#endif
+
+  }; // Timer
+
+private:
+  // Adds the statistics of its thread to the total when the thread
+  // ends, once the thread has counted anything. Holds the hardware
+  // counters of the thread, opened when they are first read.
+  class Collector
+  {
+  public:
+    bool active;
+
+    ~Collector();
+
+    void read(PerfCounters::Reading& r)
+    {
+      counters.open();
+      for (int i = 0; i < PerfCounters::NUMBER_OF_EVENTS; i++)
+        if (counters.available(i))
+          local.counted |= 1 << i;
+      counters.read(r);
+    }
+
+  private:
+    PerfCounters counters;
+
+  }; // Collector
+
+  static thread_local Stats local;
+  static thread_local Collector collector;
+  static Stats ended; // totals of the threads that have ended
+  static std::mutex lock;
+  static bool profiling;
+
+  void writeProfile(FILE*, bool) const;
+
+  // 0 to 5 for the token types, 6 to 11 for { } [ ] : ,
+  static int tokenIndex(int type)
+  {
+    switch (type)
+    {
+      case '{':
+        return 6;
+      case '}':
+        return 7;
+      case '[':
+        return 8;
+      case ']':
+        return 9;
+      case ':':
+        return 10;
+      case ',':
+        return 11;
+    }
+    return type >= 0 && type < 6 ? type : 0;
+  }
+
+}; // Stats
+
+thread_local Stats Stats::local;
+thread_local Stats::Collector Stats::collector;
+Stats Stats::ended;
+std::mutex Stats::lock;
+bool Stats::profiling = false;
+
+Stats::Collector::~Collector()
+{
+  if (active)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+
+    ended.add(local);
+  }
+}
+
+void
+Stats::add(const Stats& s)
+{
+  bytes += s.bytes;
+  for (int i = 0; i < 12; i++)
+    tokens[i] += s.tokens[i];
+  nodes += s.nodes;
+  allocated += s.allocated;
+  if (s.maxDepth > maxDepth)
+    maxDepth = s.maxDepth;
+  for (int i = 0; i < NUMBER_OF_PHASES; i++)
+  {
+    seconds[i] += s.seconds[i];
+    for (int j = 0; j < PerfCounters::NUMBER_OF_EVENTS; j++)
+      events[i][j] += s.events[i][j];
+  }
+  counted |= s.counted;
+}
+
+Stats
+Stats::total()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  Stats s = ended;
+
+  s.add(local);
+  return s;
+}
+
+void
+Stats::write(FILE* out, bool json) const
+{
+  static const char* const tokenNames[] =
+  {
+    "eof", "string", "number", "true", "false", "null",
+    "{", "}", "[", "]", ":", ","
+  };
+  static const char* const phaseNames[] = {"lex", "parse", "write"};
+
+  if (!enabled())
+  {
+    fputs(json ? "{\"enabled\": false}\n" :
+      "Estatisticas desativadas: compile com make STATS=1\n", out);
+    return;
+  }
+  if (json)
+  {
+    fprintf(out, "{\"bytes\": %llu, \"tokens\": {", (unsigned long long)bytes);
+    for (int i = 1; i < 12; i++)
+      fprintf(out, "%s\"%s\": %llu", i > 1 ? ", " : "", tokenNames[i],
+        (unsigned long long)tokens[i]);
+    fprintf(out, "}, \"nodes\": %llu, \"allocated\": %llu, \"max_depth\": %llu, \"seconds\": {",
+      (unsigned long long)nodes, (unsigned long long)allocated,
+      (unsigned long long)maxDepth);
+    for (int i = 0; i < NUMBER_OF_PHASES; i++)
+      fprintf(out, "%s\"%s\": %.6f", i > 0 ? ", " : "", phaseNames[i], seconds[i]);
+    fputc('}', out);
+    if (profiling)
+      writeProfile(out, true);
+    fputs("}\n", out);
+    return;
+  }
+  fprintf(out, "Bytes lidos: %llu\n", (unsigned long long)bytes);
+  fputs("Tokens:", out);
+  for (int i = 1; i < 12; i++)
+    fprintf(out, " %s %llu", tokenNames[i], (unsigned long long)tokens[i]);
+  fprintf(out, "\nNos: %llu\nBytes alocados: %llu\nProfundidade maxima: %llu\n",
+    (unsigned long long)nodes, (unsigned long long)allocated,
+    (unsigned long long)maxDepth);
+  for (int i = 0; i < NUMBER_OF_PHASES; i++)
+    fprintf(out, "Tempo de %s: %.3f ms\n", phaseNames[i], seconds[i] * 1e3);
+  if (profiling)
+    writeProfile(out, false);
+}
+
+// The hardware counters of each phase, per byte of input and per node;
+// an event that could not be counted is null, or left out of the text
+void
+Stats::writeProfile(FILE* out, bool json) const
+{
+  static const char* const phaseNames[] = {"lex", "parse", "write"};
+
+  if (counted == 0)
+  {
+    fputs(json ? ", \"profile\": null" :
+      "Contadores de hardware indisponiveis\n", out);
+    return;
+  }
+  if (json)
+    fputs(", \"profile\": {", out);
+  for (int i = 0; i < NUMBER_OF_PHASES; i++)
+  {
+    if (json)
+      fprintf(out, "%s\"%s\": {", i > 0 ? ", " : "", phaseNames[i]);
+    else
+      fprintf(out, "Contadores de %s:\n", phaseNames[i]);
+    for (int j = 0; j < PerfCounters::NUMBER_OF_EVENTS; j++)
+    {
+      const char* name = PerfCounters::getName(j);
+      double n = events[i][j];
+
+      if (json && (counted & 1 << j) == 0)
+        fprintf(out, "%s\"%s\": null", j > 0 ? ", " : "", name);
+      else if (json)
+        fprintf(out, "%s\"%s\": {\"count\": %.0f, \"per_byte\": %.4f, \"per_node\": %.4f}",
+          j > 0 ? ", " : "", name, n, bytes != 0 ? n / bytes : 0,
+          nodes != 0 ? n / nodes : 0);
+      else if ((counted & 1 << j) != 0)
+        fprintf(out, "  %s: %.0f (%.4f por byte, %.4f por no)\n", name, n,
+          bytes != 0 ? n / bytes : 0, nodes != 0 ? n / nodes : 0);
+    }
+    if ((counted & 1 << PerfCounters::CYCLES) != 0 && events[i][PerfCounters::CYCLES] != 0)
+    {
+      double ipc = (double)events[i][PerfCounters::INSTRUCTIONS] / events[i][PerfCounters::CYCLES];
+
+      if (json)
+        fprintf(out, ", \"ipc\": %.3f", ipc);
+      else
+        fprintf(out, "  instrucoes por ciclo: %.3f\n", ipc);
+    }
+    if (json)
+      fputc('}', out);
+  }
+  if (json)
+    fputc('}', out);
+}
+
+#endif // __Stats_h
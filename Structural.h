@@ -0,0 +1,408 @@
+#ifndef __Structural_h
+#define __Structural_h
+#include "Cpu.h"
+#include "Utf8.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+Structural index
+================
+First pass over the input, done 64 bytes at a time. Each block is
+classified into whitespace, quote, backslash and operator masks
+({ } [ ] : ,), escaped quotes and string interiors are removed with
+carry-less bit tricks, and the positions of every structural character
+plus the first byte of every scalar (string, number, true, false, null)
+are appended to the index. The lexer then jumps from one position to
+the next instead of rescanning whitespace byte by byte.
+
+On request the same pass checks that the input is valid UTF-8, while
+each block is still in the cache.
+
+The classifier is a kernel of Cpu.h, and so is the UTF-8 checker. The
+whole pass is compiled for each level with both inlined into its loop,
+and build() calls the one in use.
+*/
+
+class StructuralIndex
+{
+public:
+  // Constructor
+  StructuralIndex():
+    positions(0),
+    capacity(0),
+    count(0),
+    utf8Error(0)
+  {
+    // do nothing
+  }
+
+  // Destructor
+  ~StructuralIndex()
+  {
+    delete[] positions;
+  }
+
+  // Index the first length bytes of input, and check them for UTF-8
+  // if utf8 is true. Returns false if the input is too large to be
+  // indexed or ends inside a string.
+  bool build(const char*, size_t, bool utf8 = false);
+
+  const uint32_t* begin() const
+  {
+    return positions;
+  }
+
+  const uint32_t* end() const
+  {
+    return positions + count;
+  }
+
+  size_t size() const
+  {
+    return count;
+  }
+
+  // Offset of the first invalid UTF-8 sequence found by the last
+  // build(), or the length of the input if none was
+  size_t getUtf8Error() const
+  {
+    return utf8Error;
+  }
+
+private:
+  struct Block
+  {
+    uint64_t whitespace;
+    uint64_t op;
+    uint64_t quote;
+    uint64_t backslash;
+  };
+
+  // The kernels of each level: classify(in, block) classifies the 64
+  // bytes at in, prefixXor(x) gives bit i of x XORed with bits 0..i-1,
+  // and Checker is the UTF-8 checker
+  struct Scalar
+  {
+    typedef Utf8::Scalar Checker;
+
+    static void classify(const char*, Block&);
+    static uint64_t prefixXor(uint64_t);
+  };
+#ifdef CPU_X86
+  struct Sse42
+  {
+    typedef Utf8::Sse42 Checker;
+
+    CPU_SSE42 static void classify(const char*, Block&);
+    static uint64_t prefixXor(uint64_t x)
+    {
+      return Scalar::prefixXor(x);
+    }
+  };
+  struct Avx2
+  {
+    typedef Utf8::Avx2 Checker;
+
+    CPU_AVX2 static void classify(const char*, Block&);
+    CPU_AVX2 static uint64_t prefixXor(uint64_t);
+  };
+#endif
+
+  uint32_t* positions;
+  size_t capacity;
+  size_t count;
+  size_t utf8Error;
+
+  StructuralIndex(const StructuralIndex&);
+  StructuralIndex& operator =(const StructuralIndex&);
+
+  template <typename Kernels> bool index(const char*, size_t, bool);
+#ifdef CPU_X86
+  CPU_SSE42 CPU_DISPATCH bool indexSse42(const char*, size_t, bool);
+  CPU_AVX2 CPU_DISPATCH bool indexAvx2(const char*, size_t, bool);
+#endif
+
+  static uint64_t escaped(uint64_t, uint64_t&);
+  static size_t locate(const char*, size_t, size_t);
+
+}; // StructuralIndex
+
+/*
+Character classes used by the classifier. The vector paths look up the
+low and the high nibble of each byte and AND the results, so a byte
+belongs to a class only if both nibbles agree:
+
+  bit 0: ' '            bit 2: ','            bit 4: [ ] { }
+  bit 1: \t \n \r       bit 3: ':'
+*/
+#define SI_WHITESPACE 0x03
+#define SI_OP 0x1c
+
+inline void
+StructuralIndex::Scalar::classify(const char* in, Block& b)
+{
+  b.whitespace = b.op = b.quote = b.backslash = 0;
+  for (int i = 0; i < 64; i++)
+  {
+    uint64_t bit = 1ULL << i;
+
+    switch (in[i])
+    {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        b.whitespace |= bit;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        b.op |= bit;
+        break;
+      case '"':
+        b.quote |= bit;
+        break;
+      case '\\':
+        b.backslash |= bit;
+        break;
+    }
+  }
+}
+
+// Bit i of the result is the XOR of bits 0..i of x.
+inline uint64_t
+StructuralIndex::Scalar::prefixXor(uint64_t x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+#ifdef CPU_X86
+
+inline void
+StructuralIndex::Sse42::classify(const char* in, Block& b)
+{
+  const __m128i lo = _mm_setr_epi8(1, 0, 0, 0, 0, 0, 0, 0, 0, 2, 10, 16, 4, 18, 0, 0);
+  const __m128i hi = _mm_setr_epi8(2, 0, 5, 8, 0, 16, 0, 16, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+
+  b.whitespace = b.op = b.quote = b.backslash = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+    __m128i c = _mm_and_si128(_mm_shuffle_epi8(lo, v),
+      _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+    uint64_t ws = 0xffff & ~_mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_and_si128(c, _mm_set1_epi8(SI_WHITESPACE)), zero));
+    uint64_t op = 0xffff & ~_mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_and_si128(c, _mm_set1_epi8(SI_OP)), zero));
+    uint64_t q = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    uint64_t bs = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+
+    b.whitespace |= ws << (16 * i);
+    b.op |= op << (16 * i);
+    b.quote |= q << (16 * i);
+    b.backslash |= bs << (16 * i);
+  }
+}
+
+inline void
+StructuralIndex::Avx2::classify(const char* in, Block& b)
+{
+  const __m256i lo = _mm256_setr_epi8(
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 2, 10, 16, 4, 18, 0, 0,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 2, 10, 16, 4, 18, 0, 0);
+  const __m256i hi = _mm256_setr_epi8(
+    2, 0, 5, 8, 0, 16, 0, 16, 0, 0, 0, 0, 0, 0, 0, 0,
+    2, 0, 5, 8, 0, 16, 0, 16, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  uint64_t ws[2], op[2], q[2], bs[2];
+
+  for (int i = 0; i < 2; i++)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(in + 32 * i));
+    __m256i c = _mm256_and_si256(_mm256_shuffle_epi8(lo, v),
+      _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+
+    ws[i] = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      _mm256_and_si256(c, _mm256_set1_epi8(SI_WHITESPACE)), zero));
+    op[i] = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      _mm256_and_si256(c, _mm256_set1_epi8(SI_OP)), zero));
+    q[i] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+    bs[i] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+  }
+  b.whitespace = (uint32_t)ws[0] | ws[1] << 32;
+  b.op = (uint32_t)op[0] | op[1] << 32;
+  b.quote = q[0] | q[1] << 32;
+  b.backslash = bs[0] | bs[1] << 32;
+}
+
+// The same with a carry-less multiplication by all ones
+inline uint64_t
+StructuralIndex::Avx2::prefixXor(uint64_t x)
+{
+  __m128i all = _mm_set1_epi8((char)0xff);
+
+  return _mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, x), all, 0));
+}
+
+#endif
+
+// Mask of the characters escaped by a backslash. prevEscaped carries
+// the escape of the first character of the next block.
+inline uint64_t
+StructuralIndex::escaped(uint64_t backslash, uint64_t& prevEscaped)
+{
+  const uint64_t evenBits = 0x5555555555555555ULL;
+
+  backslash &= ~prevEscaped;
+
+  uint64_t followsEscape = backslash << 1 | prevEscaped;
+  uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+  uint64_t evenSequences;
+
+  prevEscaped = __builtin_add_overflow(oddStarts, backslash, &evenSequences);
+  return (evenBits ^ (evenSequences << 1)) & followsEscape;
+}
+
+// Offset of the first invalid UTF-8 sequence of input, known to be at
+// or after the sequence that goes on at offset from
+inline size_t
+StructuralIndex::locate(const char* input, size_t length, size_t from)
+{
+  // The bytes before from are valid, but the sequence may begin up to
+  // three bytes back
+  size_t p = from > 3 ? from - 3 : 0;
+
+  while (p < from && (input[p] & 0xc0) == 0x80)
+    p++;
+  return p + Utf8::find(input + p, length - p);
+}
+
+bool
+StructuralIndex::build(const char* input, size_t length, bool utf8)
+{
+  count = 0;
+  utf8Error = length;
+  if (length > UINT32_MAX - 64)
+  {
+    if (utf8)
+      utf8Error = Utf8::find(input, length);
+    return false;
+  }
+  if (capacity < length + 1)
+  {
+    delete[] positions;
+    capacity = length + 1;
+    positions = new uint32_t[capacity];
+  }
+#ifdef CPU_X86
+  switch (Cpu::level)
+  {
+    case Cpu::AVX2:
+      return indexAvx2(input, length, utf8);
+    case Cpu::SSE42:
+      return indexSse42(input, length, utf8);
+    default:
+      break;
+  }
+#endif
+  return index<Scalar>(input, length, utf8);
+}
+
+#ifdef CPU_X86
+
+bool
+StructuralIndex::indexSse42(const char* input, size_t length, bool utf8)
+{
+  return index<Sse42>(input, length, utf8);
+}
+
+bool
+StructuralIndex::indexAvx2(const char* input, size_t length, bool utf8)
+{
+  return index<Avx2>(input, length, utf8);
+}
+
+#endif
+
+// The pass itself, into positions, which has room for length + 1
+template <typename Kernels>
+inline bool
+StructuralIndex::index(const char* input, size_t length, bool utf8)
+{
+  typename Kernels::Checker checker;
+  uint32_t* out = positions;
+  uint64_t prevEscaped = 0;
+  uint64_t prevInString = 0;
+  uint64_t prevScalar = 0;
+  char tail[64];
+
+  for (size_t base = 0; base < length; base += 64)
+  {
+    const char* in = input + base;
+    Block b;
+
+    if (length - base < 64)
+    {
+      memset(tail, ' ', 64);
+      memcpy(tail, in, length - base);
+      in = tail;
+    }
+    Kernels::classify(in, b);
+    if (utf8)
+    {
+      checker.check(in);
+      if (checker.failed())
+      {
+        utf8Error = locate(input, length, base);
+        utf8 = false;
+      }
+    }
+
+    uint64_t quote = b.quote & ~escaped(b.backslash, prevEscaped);
+    uint64_t inString = Kernels::prefixXor(quote) ^ prevInString;
+
+    prevInString = (uint64_t)((int64_t)inString >> 63);
+
+    uint64_t scalar = ~(b.op | b.whitespace);
+    uint64_t nonQuoteScalar = scalar & ~quote;
+    uint64_t followsScalar = nonQuoteScalar << 1 | prevScalar;
+
+    prevScalar = nonQuoteScalar >> 63;
+
+    uint64_t bits = (b.op | (scalar & ~followsScalar)) & ~(inString ^ quote);
+
+    while (bits != 0)
+    {
+      *out++ = (uint32_t)(base + __builtin_ctzll(bits));
+      bits &= bits - 1;
+    }
+  }
+  count = out - positions;
+  if (utf8)
+  {
+    if (!Kernels::Checker::VECTOR)
+      utf8Error = Utf8::find(input, length);
+    // The last block was padded with spaces unless it was full
+    else if (checker.failed(true))
+      utf8Error = locate(input, length, length);
+  }
+  return prevInString == 0;
+}
+
+#undef SI_WHITESPACE
+#undef SI_OP
+
+#endif // __Structural_h
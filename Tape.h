@@ -0,0 +1,389 @@
+#ifndef __Tape_h
+#define __Tape_h
+#include "Escape.h"
+#include "Writer.h"
+#include "Object.h"
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+#include <vector>
+
+/*
+Tape
+====
+Read-only document stored as one contiguous array of 64-bit words. The
+top 8 bits of a word are its tag and the low 56 bits its payload:
+
+  'r'  root; the first word points past the last one, the last word to 0
+  '{'  start of object; low 32 bits: index after the matching '}',
+       bits 32..55: number of members, capped at 0xffffff
+  '}'  end of object; payload: index of the matching '{'
+  '['  start of array; like '{', counting elements
+  ']'  end of array; payload: index of the matching '['
+  '"'  string or member key; payload: offset in the string buffer
+  'n'  number; payload: offset of its text in the string buffer
+  't'  true
+  'f'  false
+  'N'  null
+
+An object member is a '"' word for the key followed by the words of its
+value. Strings and number texts are stored in the string buffer as a
+32-bit length followed by the bytes and a '\0'; strings and keys are
+kept as in the input, still escaped.
+*/
+
+class TapeRef;
+
+class Tape: public Object
+{
+public:
+  enum Tag
+  {
+    ROOT = 'r',
+    START_OBJECT = '{',
+    END_OBJECT = '}',
+    START_ARRAY = '[',
+    END_ARRAY = ']',
+    STRING = '"',
+    NUMBER = 'n',
+    TRUE = 't',
+    FALSE = 'f',
+    NULL_ = 'N'
+  }; // Tag
+
+  static int tagOf(uint64_t word)
+  {
+    return (int)(word >> 56);
+  }
+
+  static uint64_t payloadOf(uint64_t word)
+  {
+    return word & PAYLOAD;
+  }
+
+  int getTag(size_t i) const
+  {
+    return tagOf(words[i]);
+  }
+
+  uint64_t getPayload(size_t i) const
+  {
+    return payloadOf(words[i]);
+  }
+
+  // Index of the word after the value starting at i
+  size_t skip(size_t i) const
+  {
+    int tag = getTag(i);
+
+    if (tag == START_OBJECT || tag == START_ARRAY)
+      return (uint32_t)words[i];
+    return i + 1;
+  }
+
+  std::string_view getString(size_t i) const
+  {
+    const char* s = &strings[getPayload(i)];
+    uint32_t n;
+
+    memcpy(&n, s, sizeof(n));
+    return std::string_view(s + sizeof(n), n);
+  }
+
+  size_t size() const
+  {
+    return words.size();
+  }
+
+  TapeRef getRoot() const;
+
+  void write(Writer&) const;
+
+  // Building
+  size_t append(int tag, uint64_t payload = 0)
+  {
+    words.push_back((uint64_t)tag << 56 | payload);
+    return words.size() - 1;
+  }
+
+  // Largest count of members or elements a start word holds
+  enum { MAX_COUNT = 0xffffff };
+
+  size_t appendString(int tag, std::string_view);
+  void closeContainer(size_t, int, uint32_t);
+  void clear()
+  {
+    words.clear();
+    strings.clear();
+  }
+
+private:
+  static const uint64_t PAYLOAD = (1ULL << 56) - 1;
+
+  std::vector<uint64_t> words; // nodes
+  std::vector<char> strings; // string buffer
+
+  size_t writeValue(Writer&, size_t, size_t) const;
+  size_t writeContainer(Writer&, size_t) const;
+
+}; // Tape
+
+typedef ObjectPtr<Tape> TapePtr;
+
+// Reference to a value in a tape
+class TapeRef
+{
+public:
+  TapeRef(const Tape* tape, size_t index):
+    tape(tape),
+    index(index)
+  {
+    // do nothing
+  }
+
+  // Tag of the value, or 0, which matches no tag, for an invalid
+  // reference
+  int getTag() const
+  {
+    return tape != 0 ? tape->getTag(index) : 0;
+  }
+
+  bool isObject() const
+  {
+    return getTag() == Tape::START_OBJECT;
+  }
+
+  bool isArray() const
+  {
+    return getTag() == Tape::START_ARRAY;
+  }
+
+  bool isString() const
+  {
+    return getTag() == Tape::STRING;
+  }
+
+  bool isNumber() const
+  {
+    return getTag() == Tape::NUMBER;
+  }
+
+  bool isNull() const
+  {
+    return getTag() == Tape::NULL_;
+  }
+
+  // Contents of a string, still escaped, or text of a number; empty for
+  // other values
+  std::string_view getText() const
+  {
+    return isString() || isNumber() ? tape->getString(index) : std::string_view();
+  }
+
+  bool getBool() const
+  {
+    return getTag() == Tape::TRUE;
+  }
+
+  // Number of members or elements of a container, 0 for other values.
+  // The tape holds counts up to 0xfffffe; larger ones are counted by
+  // walking the container.
+  int size() const;
+
+  // Element i of an array; O(1) per skipped sibling
+  TapeRef operator [](int) const;
+
+  // Value of the first member named key, or a reference whose
+  // isValid() is false. Keys are compared unescaped, as by Obj::get().
+  TapeRef get(std::string_view) const;
+
+  bool isValid() const
+  {
+    return tape != 0;
+  }
+
+private:
+  const Tape* tape;
+  size_t index;
+
+}; // TapeRef
+
+inline TapeRef
+Tape::getRoot() const
+{
+  return TapeRef(this, 1);
+}
+
+size_t
+Tape::appendString(int tag, std::string_view s)
+{
+  size_t offset = strings.size();
+  uint32_t n = (uint32_t)s.size();
+
+  strings.resize(offset + sizeof(n) + n + 1);
+  memcpy(&strings[offset], &n, sizeof(n));
+  memcpy(&strings[offset + sizeof(n)], s.data(), n);
+  strings[offset + sizeof(n) + n] = '\0';
+  return append(tag, offset);
+}
+
+// Write the end word of the container started at begin and point the
+// start word past it
+void
+Tape::closeContainer(size_t begin, int endTag, uint32_t count)
+{
+  size_t end = append(endTag, begin);
+
+  if (count > MAX_COUNT)
+    count = MAX_COUNT;
+  words[begin] |= (uint64_t)count << 32 | (end + 1);
+}
+
+int
+TapeRef::size() const
+{
+  if (!isObject() && !isArray())
+    return 0;
+
+  int n = (int)(tape->getPayload(index) >> 32 & Tape::MAX_COUNT);
+
+  if (n < Tape::MAX_COUNT)
+    return n;
+
+  size_t end = tape->skip(index) - 1;
+  // a member is a key word and its value
+  size_t key = isObject() ? 1 : 0;
+
+  n = 0;
+  for (size_t i = index + 1; i < end; n++)
+    i = tape->skip(i + key);
+  return n;
+}
+
+// Walks up to the end word, since the count may be capped
+TapeRef
+TapeRef::operator [](int n) const
+{
+  if (!isArray() || n < 0)
+    return TapeRef(0, 0);
+
+  size_t end = tape->skip(index) - 1;
+  size_t i = index + 1;
+
+  for (; n > 0 && i < end; n--)
+    i = tape->skip(i);
+  return i < end ? TapeRef(tape, i) : TapeRef(0, 0);
+}
+
+TapeRef
+TapeRef::get(std::string_view key) const
+{
+  if (!isObject())
+    return TapeRef(0, 0);
+
+  size_t end = tape->skip(index) - 1;
+  std::string unescaped;
+
+  for (size_t i = index + 1; i < end; i = tape->skip(i + 1))
+  {
+    std::string_view k = tape->getString(i);
+
+    // Only a key with an escape differs from its unescaped form
+    if (memchr(k.data(), '\\', k.size()) == 0 ? k == key :
+      Escape::unescape(k, unescaped) && unescaped == key)
+      return TapeRef(tape, i + 1);
+  }
+  return TapeRef(0, 0);
+}
+
+/*Declaracao do Write*/
+
+void
+Tape::write(Writer& writer) const
+{
+  writer.beginLine();
+  writer.write("Json");
+  writer.endLine();
+  writer.beginBlock();
+  writeValue(writer, 1, 0);
+  writer.backspace();
+  writer.endBlock();
+}
+
+// Write the value at i; key is the index of its member key, if any
+size_t
+Tape::writeValue(Writer& writer, size_t i, size_t key) const
+{
+  writer.beginLine();
+  if (key != 0)
+  {
+    std::string_view s = getString(key);
+
+    writer.write('"');
+    writer.write(s);
+    writer.write("\":");
+  }
+
+  int tag = getTag(i);
+
+  if (tag == START_OBJECT || tag == START_ARRAY)
+  {
+    writer.write("Value");
+    writer.endLine();
+    writer.beginBlock();
+    i = writeContainer(writer, i);
+    writer.endBlock();
+    return i;
+  }
+  switch (tag)
+  {
+    case STRING:
+    {
+      std::string_view s = getString(i);
+
+      writer.write('"');
+      writer.write(s);
+      writer.write('"');
+      break;
+    }
+    case NUMBER:
+    {
+      std::string_view s = getString(i);
+
+      writer.write(s);
+      break;
+    }
+    case TRUE:
+      writer.write("true");
+      break;
+    case FALSE:
+      writer.write("false");
+      break;
+    case NULL_:
+      writer.write("null");
+      break;
+  }
+  writer.endLine();
+  return i + 1;
+}
+
+size_t
+Tape::writeContainer(Writer& writer, size_t i) const
+{
+  bool object = getTag(i) == START_OBJECT;
+  size_t end = skip(i) - 1;
+
+  writer.beginLine();
+  writer.write(object ? "Object" : "Array");
+  writer.endLine();
+  writer.beginBlock();
+  for (++i; i < end;)
+    if (object)
+      i = writeValue(writer, i + 1, i);
+    else
+      i = writeValue(writer, i, 0);
+  writer.endBlock();
+  return end + 1;
+}
+
+#endif // __Tape_h
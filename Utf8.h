@@ -0,0 +1,348 @@
+#ifndef __Utf8_h
+#define __Utf8_h
+#include "Cpu.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+UTF-8 validation
+================
+Checks the input 64 bytes at a time, in the same pass that builds the
+structural index. Blocks of ASCII only cost one test. In other blocks,
+each byte is looked up together with the one before it in three tables
+of 16 entries, indexed by the high nibble of the previous byte, its low
+nibble and the high nibble of the byte itself. Each entry is a set of
+error bits: too short (a lead byte not followed by enough continuation
+bytes), too long, overlong, surrogate, beyond U+10FFFF, and two
+continuations. A pair is wrong when all three entries share a bit. The
+third and fourth bytes of longer sequences are checked against the
+lead byte two or three positions back.
+
+The tables only say that something is wrong in the block; find() then
+rescans the few bytes around it one at a time to report the offset of
+the first invalid sequence. There is a checker for each level of Cpu.h;
+the scalar one checks nothing, and the whole input is checked by find()
+instead.
+*/
+
+class Utf8
+{
+public:
+  // Offset of the first invalid sequence in the size bytes at p, or
+  // size if they are all valid
+  static size_t find(const char* p, size_t size);
+
+  // Checkers of a sequence of 64-byte blocks, with:
+  //
+  // VECTOR        false if the checker leaves the input to find()
+  // check(in)     check the next 64 bytes
+  // failed(atEnd) whether an invalid sequence was found so far; with
+  //               atEnd, also a sequence cut short by the end of the
+  //               last block
+  class Scalar;
+#ifdef CPU_X86
+  class Sse42;
+  class Avx2;
+#endif
+
+}; // Utf8
+
+class Utf8::Scalar
+{
+public:
+  static const bool VECTOR = false;
+
+  void check(const char*)
+  {
+    // do nothing: find() checks the whole input
+  }
+
+  bool failed(bool = false) const
+  {
+    return false;
+  }
+
+}; // Utf8::Scalar
+
+#ifdef CPU_X86
+
+class Utf8::Sse42
+{
+public:
+  static const bool VECTOR = true;
+
+  CPU_SSE42 Sse42();
+  CPU_SSE42 void check(const char*);
+  CPU_SSE42 bool failed(bool atEnd = false) const;
+
+private:
+  typedef __m128i Vector;
+
+  Vector error; // error bits found so far
+  Vector previous; // last vector checked
+  Vector incomplete; // bytes of previous that start a sequence going on
+
+  CPU_SSE42 void check(Vector);
+
+}; // Utf8::Sse42
+
+class Utf8::Avx2
+{
+public:
+  static const bool VECTOR = true;
+
+  CPU_AVX2 Avx2();
+  CPU_AVX2 void check(const char*);
+  CPU_AVX2 bool failed(bool atEnd = false) const;
+
+private:
+  typedef __m256i Vector;
+
+  Vector error;
+  Vector previous;
+  Vector incomplete;
+
+  CPU_AVX2 void check(Vector);
+
+}; // Utf8::Avx2
+
+#endif
+
+// Error bits of the tables
+#define U8_TOO_SHORT (1 << 0)
+#define U8_TOO_LONG (1 << 1)
+#define U8_OVERLONG_3 (1 << 2)
+#define U8_TOO_LARGE (1 << 3)
+#define U8_SURROGATE (1 << 4)
+#define U8_OVERLONG_2 (1 << 5)
+#define U8_TOO_LARGE_1000 (1 << 6)
+#define U8_OVERLONG_4 (1 << 6)
+#define U8_TWO_CONTS (1 << 7)
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLES(set) \
+  const Vector high1 = set( \
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, \
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, \
+    U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, \
+    U8_TOO_SHORT | U8_OVERLONG_2, \
+    U8_TOO_SHORT, \
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE, \
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4); \
+  const Vector low1 = set( \
+    U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4, \
+    U8_CARRY | U8_OVERLONG_2, \
+    U8_CARRY, \
+    U8_CARRY, \
+    U8_CARRY | U8_TOO_LARGE, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, \
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000); \
+  const Vector high2 = set( \
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, \
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, \
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | \
+      U8_TOO_LARGE_1000 | U8_OVERLONG_4, \
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE, \
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE, \
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE, \
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT)
+
+#ifdef CPU_X86
+
+#define U8_SET(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+inline
+Utf8::Avx2::Avx2()
+{
+  error = previous = incomplete = _mm256_setzero_si256();
+}
+
+inline void
+Utf8::Avx2::check(Vector v)
+{
+  U8_TABLES(U8_SET);
+  const Vector nibble = _mm256_set1_epi8(0x0f);
+  // Bytes 16..31 of previous and 0..15 of v, to shift v right across
+  // the two lanes
+  Vector across = _mm256_permute2x128_si256(previous, v, 0x21);
+  Vector prev1 = _mm256_alignr_epi8(v, across, 15);
+  Vector prev2 = _mm256_alignr_epi8(v, across, 14);
+  Vector prev3 = _mm256_alignr_epi8(v, across, 13);
+  Vector special = _mm256_and_si256(_mm256_and_si256(
+    _mm256_shuffle_epi8(high1, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+    _mm256_shuffle_epi8(low1, _mm256_and_si256(prev1, nibble))),
+    _mm256_shuffle_epi8(high2, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+  // High bit set where a third or fourth byte must be a continuation
+  Vector must23 = _mm256_and_si256(_mm256_or_si256(
+    _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+    _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80))),
+    _mm256_set1_epi8(0x80));
+
+  error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+  incomplete = _mm256_subs_epu8(v, _mm256_setr_epi8(
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    0xf0 - 1, 0xe0 - 1, 0xc0 - 1));
+  previous = v;
+}
+
+inline void
+Utf8::Avx2::check(const char* in)
+{
+  Vector a = _mm256_loadu_si256((const Vector*)in);
+  Vector b = _mm256_loadu_si256((const Vector*)(in + 32));
+
+  if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) == 0)
+  {
+    error = _mm256_or_si256(error, incomplete);
+    return;
+  }
+  check(a);
+  check(b);
+}
+
+inline bool
+Utf8::Avx2::failed(bool atEnd) const
+{
+  Vector e = atEnd ? _mm256_or_si256(error, incomplete) : error;
+
+  return !_mm256_testz_si256(e, e);
+}
+
+#undef U8_SET
+
+#define U8_SET _mm_setr_epi8
+
+inline
+Utf8::Sse42::Sse42()
+{
+  error = previous = incomplete = _mm_setzero_si128();
+}
+
+inline void
+Utf8::Sse42::check(Vector v)
+{
+  U8_TABLES(U8_SET);
+  const Vector nibble = _mm_set1_epi8(0x0f);
+  Vector prev1 = _mm_alignr_epi8(v, previous, 15);
+  Vector prev2 = _mm_alignr_epi8(v, previous, 14);
+  Vector prev3 = _mm_alignr_epi8(v, previous, 13);
+  Vector special = _mm_and_si128(_mm_and_si128(
+    _mm_shuffle_epi8(high1, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+    _mm_shuffle_epi8(low1, _mm_and_si128(prev1, nibble))),
+    _mm_shuffle_epi8(high2, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+  Vector must23 = _mm_and_si128(_mm_or_si128(
+    _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+    _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80))),
+    _mm_set1_epi8(0x80));
+
+  error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+  incomplete = _mm_subs_epu8(v, _mm_setr_epi8(
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    0xf0 - 1, 0xe0 - 1, 0xc0 - 1));
+  previous = v;
+}
+
+inline void
+Utf8::Sse42::check(const char* in)
+{
+  Vector v[4];
+  Vector any = _mm_setzero_si128();
+
+  for (int i = 0; i < 4; i++)
+  {
+    v[i] = _mm_loadu_si128((const Vector*)(in + 16 * i));
+    any = _mm_or_si128(any, v[i]);
+  }
+  if (_mm_movemask_epi8(any) == 0)
+  {
+    error = _mm_or_si128(error, incomplete);
+    return;
+  }
+  for (int i = 0; i < 4; i++)
+    check(v[i]);
+}
+
+inline bool
+Utf8::Sse42::failed(bool atEnd) const
+{
+  Vector e = atEnd ? _mm_or_si128(error, incomplete) : error;
+
+  return !_mm_testz_si128(e, e);
+}
+
+#undef U8_SET
+
+#endif
+
+size_t
+Utf8::find(const char* p, size_t size)
+{
+  const unsigned char* s = (const unsigned char*)p;
+  size_t i = 0;
+
+  while (i < size)
+  {
+    unsigned char c = s[i];
+
+    if (c < 0x80)
+    {
+      i++;
+      continue;
+    }
+
+    int n; // continuation bytes
+    unsigned char min = 0x80, max = 0xbf; // range of the second byte
+
+    if (c >= 0xc2 && c <= 0xdf)
+      n = 1;
+    else if (c >= 0xe0 && c <= 0xef)
+    {
+      n = 2;
+      if (c == 0xe0)
+        min = 0xa0; // overlong
+      else if (c == 0xed)
+        max = 0x9f; // surrogate
+    }
+    else if (c >= 0xf0 && c <= 0xf4)
+    {
+      n = 3;
+      if (c == 0xf0)
+        min = 0x90; // overlong
+      else if (c == 0xf4)
+        max = 0x8f; // beyond U+10FFFF
+    }
+    else
+      return i;
+    if (size - i <= (size_t)n || s[i + 1] < min || s[i + 1] > max)
+      return i;
+    for (int k = 2; k <= n; k++)
+      if ((s[i + k] & 0xc0) != 0x80)
+        return i;
+    i += n + 1;
+  }
+  return size;
+}
+
+#undef U8_TOO_SHORT
+#undef U8_TOO_LONG
+#undef U8_OVERLONG_3
+#undef U8_TOO_LARGE
+#undef U8_SURROGATE
+#undef U8_OVERLONG_2
+#undef U8_TOO_LARGE_1000
+#undef U8_OVERLONG_4
+#undef U8_TWO_CONTS
+#undef U8_CARRY
+#undef U8_TABLES
+
+#endif // __Utf8_h
@@ -1,101 +1,144 @@
-#ifndef __Writer_h
-#define __Writer_h
-#include <stdarg.h>
-#include <stdio.h>
-#include <stdlib.h>
-#ifndef WIN32
-#include <wchar.h>
-#endif
-#define MB_LENGTH 1024
-
-class Writer
-{
-public:
-  // Constructors
-  Writer()
-  {
-   // out = fopen("oie.txt", "w");
-    out = stdout;
-    level = 0;
-  }
-
-  Writer(const char* fileName)
-  {
-    out = fopen(fileName, "w");
-    level = 0;
-  }
-
-  // Destructor
-  ~Writer()
-  {
-    fclose(out);
-  }
-
-  void write(int c)
-  {
-    fputc(c, out);
-  }
-
-  void write(const wchar_t*, ...);
-
-  void beginBlock()
-  {
-    writeTabs();
-    fprintf(out, "{\n");
-    level++;
-  }
-
-  void endBlock()
-  {
-    level--;
-    writeTabs();
-    fprintf(out, "}\n");
-  }
-
-  void backspace()
-  {
-    level--;
-  }
-
-  void tab()
-  {
-    level++;
-  }
-
-  void beginLine()
-  {
-    writeTabs();
-  }
-
-  void endLine()
-  {
-    fputc('\n', out);
-  }
-
-private:
-  void writeTabs()
-  {
-    if (level == 0)
-      return;
-    for (int i = 0; i < level; i++)
-      fprintf(out, "  ");
-  }
-
-  FILE* out;
-  int level;
-
-}; // Writer
-
-void
-Writer::write(const wchar_t* fmt, ...)
-{
-  va_list args;
-  char mbfmt[MB_LENGTH];
-
-  wcstombs(mbfmt, fmt, MB_LENGTH - 1);
-  va_start(args, fmt);
-  vfprintf(out, mbfmt, args);
-}
-
-#endif // __Writer_h
-
+#ifndef __Writer_h
+#define __Writer_h
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string_view>
+
+// Indented text output. Everything goes to a buffer that is written
+// out in large blocks when it fills up and when the writer is
+// destroyed, so each line costs a few memcpy calls instead of stdio
+// calls. Names and lexemes are copied as they are, with no printf
+// formatting.
+class Writer
+{
+public:
+  // Constructors
+  Writer()
+  {
+   // out = fopen("oie.txt", "w");
+    out = stdout;
+    level = 0;
+    used = 0;
+  }
+
+  Writer(const char* fileName)
+  {
+    out = fopen(fileName, "w");
+    level = 0;
+    used = 0;
+  }
+
+  // Destructor
+  ~Writer()
+  {
+    flush();
+    fclose(out);
+  }
+
+  void write(int c)
+  {
+    if (used == BUFFER_SIZE)
+      flush();
+    buffer[used++] = c;
+  }
+
+  void write(const char* s, size_t n)
+  {
+    if (n > BUFFER_SIZE - used)
+    {
+      flush();
+      if (n > BUFFER_SIZE)
+      {
+        fwrite(s, 1, n, out);
+        return;
+      }
+    }
+    memcpy(buffer + used, s, n);
+    used += n;
+  }
+
+  void write(std::string_view s)
+  {
+    write(s.data(), s.size());
+  }
+
+  void beginBlock()
+  {
+    writeTabs();
+    write("{\n", 2);
+    level++;
+  }
+
+  void endBlock()
+  {
+    level--;
+    writeTabs();
+    write("}\n", 2);
+  }
+
+  void backspace()
+  {
+    level--;
+  }
+
+  void tab()
+  {
+    level++;
+  }
+
+  void beginLine()
+  {
+    writeTabs();
+  }
+
+  void endLine()
+  {
+    write('\n');
+  }
+
+  void writeSpaces(size_t n)
+  {
+    static const char spaces[SPACES + 1] =
+      "                                                                "
+      "                                                                ";
+
+    for (; n > SPACES; n -= SPACES)
+      write(spaces, SPACES);
+    write(spaces, n);
+  }
+
+  // Write out what is buffered, e.g. before something else writes to
+  // the same file
+  void flush()
+  {
+    if (used != 0)
+      fwrite(buffer, 1, used, out);
+    used = 0;
+    fflush(out);
+  }
+
+private:
+  enum
+  {
+    BUFFER_SIZE = 1 << 18,
+    SPACES = 128 // indentation written at a time
+  };
+
+  void writeTabs()
+  {
+    if (level > 0)
+      writeSpaces(2 * level);
+  }
+
+  FILE* out;
+  int level;
+  size_t used; // bytes in buffer
+  char buffer[BUFFER_SIZE];
+
+  Writer(const Writer&);
+  Writer& operator =(const Writer&);
+
+}; // Writer
+
+#endif // __Writer_h
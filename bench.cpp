@@ -0,0 +1,289 @@
+// Benchmark harness. Each file is put through four stages:
+//
+// lex       the lexer alone, token after token
+// validate  the reader with the Counter handler of jr, UTF-8 checked
+// tree      the tree built by Parser.h, UTF-8 checked
+// write     the tree written by Writer.h, to /dev/null
+//
+// Every stage of every file runs in a child process of its own, so that
+// its peak resident set is its own and not the largest seen so far. The
+// input is loaded before the stage is timed, and the stage is repeated
+// until it has taken at least a second, or a given number of times; the
+// fastest run is reported, with the allocations of the first one, which
+// finds no buffers to reuse. The results are written as one JSON object
+// per line, in a fixed order, so that the output of two commits can be
+// compared with diff or any line-oriented tool:
+//
+//   bench [-r runs] [-p] file...
+//
+// Each line names the kernels of Cpu.h in use, so that a run with
+// JSON_SIMD=scalar, say, can be told from the default one.
+//
+// With -p the hardware counters of Perf.h are read around every run, and
+// their mean per run is reported along with its ratio to the bytes of
+// the file and to the values in it; an event the machine cannot count
+// is null.
+#include "Counter.h"
+#include "Parser.h"
+#include "Perf.h"
+#include <chrono>
+#include <new>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Calls of operator new, which include the vectors of the parser stacks
+// and the structural index; the blocks of an arena are counted apart
+static uint64_t allocations = 0;
+
+void*
+operator new(size_t size)
+{
+  void* p = malloc(size != 0 ? size : 1);
+
+  if (p == 0)
+    throw std::bad_alloc();
+  allocations++;
+  return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+// The lexer alone
+class TokenCounter: public Lexer
+{
+public:
+  size_t count(Input* source)
+  {
+    size_t n = 0;
+
+    start(source);
+    for (; lookahead.type != Token::EOF_; n++)
+      advance();
+    return n;
+  }
+
+}; // TokenCounter
+
+// What a stage measured, sent by the child to the parent
+struct Result
+{
+  double seconds; // fastest run
+  int runs;
+  uint64_t allocations; // in the first run, with nothing to reuse
+  uint64_t nodes; // values in the document
+  uint32_t counted; // bit i set if event i could be counted
+  uint64_t events[PerfCounters::NUMBER_OF_EVENTS]; // sums of all runs
+  bool failed;
+};
+
+static bool profiling = false;
+
+static const char* const stages[] = {"lex", "validate", "tree", "write"};
+static const int NUMBER_OF_STAGES = sizeof(stages) / sizeof(stages[0]);
+
+// One run of a stage; the tree for write is built before
+static void
+run(int stage, Input* input, Parser& parser, Json* json, uint64_t& blocks)
+{
+  switch (stage)
+  {
+    case 0:
+    {
+      TokenCounter lexer;
+
+      lexer.count(input);
+      break;
+    }
+    case 1:
+    {
+      Reader reader;
+      Counter counter;
+
+      reader.setValidateUtf8(true);
+      reader.parse(input, counter);
+      break;
+    }
+    case 2:
+    {
+      JsonPtr j = parser.parse(input);
+
+      blocks = j->arena->getNumberOfBlocks();
+      break;
+    }
+    case 3:
+    {
+      Writer writer("/dev/null");
+
+      json->write(writer);
+      writer.flush();
+      break;
+    }
+  }
+}
+
+static Result
+measure(const char* fileName, int stage, int runs)
+{
+  Result r;
+  InputPtr input = Input::load(fileName);
+
+  memset(&r, 0, sizeof(r));
+  r.failed = true;
+
+  if (input == 0)
+    return r;
+  try
+  {
+    Parser parser;
+    JsonPtr json;
+    uint64_t blocks = 0;
+    double total = 0;
+    PerfCounters counters;
+
+    parser.setValidateUtf8(true);
+    if (stage == 3)
+      json = parser.parse(input);
+    if (profiling)
+    {
+      Reader reader;
+      Counter counter;
+
+      reader.parse(input, counter);
+      r.nodes = counter.membros + counter.elementos + 1;
+      counters.open();
+      for (int i = 0; i < PerfCounters::NUMBER_OF_EVENTS; i++)
+        if (counters.available(i))
+          r.counted |= 1 << i;
+    }
+    r.seconds = 1e300;
+    while (runs > 0 ? r.runs < runs : total < 1 || r.runs < 3)
+    {
+      uint64_t before = allocations;
+      PerfCounters::Reading begin;
+      PerfCounters::Reading end;
+
+      counters.read(begin);
+
+      auto start = std::chrono::steady_clock::now();
+
+      run(stage, input, parser, json, blocks);
+
+      double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      counters.read(end);
+      PerfCounters::add(begin, end, r.events);
+
+      if (r.runs == 0)
+        r.allocations = allocations - before + blocks;
+      if (t < r.seconds)
+        r.seconds = t;
+      total += t;
+      r.runs++;
+    }
+    r.failed = false;
+  }
+  catch (const ParseError& e)
+  {
+    fprintf(stderr, "%s: %s na linha %d, coluna %d\n", fileName, e.getMessage(),
+      e.lineNumber, e.column);
+  }
+  return r;
+}
+
+// Run a stage in a child; returns false if it failed
+static bool
+report(const char* fileName, int stage, int runs)
+{
+  int channel[2];
+
+  fflush(stdout);
+  if (pipe(channel) != 0)
+    return false;
+
+  pid_t child = fork();
+
+  if (child == 0)
+  {
+    Result r = measure(fileName, stage, runs);
+
+    close(channel[0]);
+    write(channel[1], &r, sizeof(r));
+    _exit(0);
+  }
+  close(channel[1]);
+
+  Result r;
+  bool ok = read(channel[0], &r, sizeof(r)) == sizeof(r) && !r.failed;
+  struct rusage usage;
+  int status;
+
+  close(channel[0]);
+  wait4(child, &status, 0, &usage);
+  if (!ok)
+    return false;
+
+  struct stat info;
+  double bytes = stat(fileName, &info) == 0 ? info.st_size : 0;
+
+  printf("{\"file\": \"%s\", \"stage\": \"%s\", \"simd\": \"%s\", \"bytes\": %.0f, "
+    "\"runs\": %d, \"seconds\": %.6f, \"mb_per_s\": %.1f, \"docs_per_s\": %.1f, "
+    "\"allocations\": %llu, \"peak_rss_kb\": %ld",
+    fileName, stages[stage], Cpu::getName(Cpu::level), bytes, r.runs, r.seconds,
+    bytes / r.seconds / 1e6, 1 / r.seconds, (unsigned long long)r.allocations,
+    usage.ru_maxrss);
+  if (profiling)
+  {
+    printf(", \"nodes\": %llu", (unsigned long long)r.nodes);
+    for (int i = 0; i < PerfCounters::NUMBER_OF_EVENTS; i++)
+    {
+      const char* name = PerfCounters::getName(i);
+      double n = (double)r.events[i] / r.runs;
+
+      if ((r.counted & 1 << i) == 0)
+        printf(", \"%s\": null, \"%s_per_byte\": null, \"%s_per_node\": null",
+          name, name, name);
+      else
+        printf(", \"%s\": %.0f, \"%s_per_byte\": %.4f, \"%s_per_node\": %.4f",
+          name, n, name, bytes != 0 ? n / bytes : 0, name, r.nodes != 0 ? n / r.nodes : 0);
+    }
+  }
+  puts("}");
+  return true;
+}
+
+int
+main(int argc, char** argv)
+{
+  int runs = 0;
+  int arg = 1;
+  int failures = 0;
+
+  for (; arg < argc && argv[arg][0] == '-'; arg++)
+    if (strcmp(argv[arg], "-p") == 0)
+      profiling = true;
+    else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc)
+      runs = atoi(argv[++arg]);
+    else
+      break;
+  if (argc <= arg)
+  {
+    fprintf(stderr, "uso: bench [-r execucoes] [-p] arquivo...\n");
+    return 1;
+  }
+  for (; arg < argc; arg++)
+    for (int stage = 0; stage < NUMBER_OF_STAGES; stage++)
+      if (!report(argv[arg], stage, runs))
+        failures++;
+  return failures != 0;
+}
@@ -0,0 +1,469 @@
+// Checks of the parts of the library that no mode of the parser runs,
+// called by make check after it compares the vector kernels:
+//
+// lazy  LazyDocument and LazyValue on valid and malformed input
+// tape  TapeRef lookups, invalid references, and containers too large
+//       for the count of their start word
+// format  doubles set with Value::setDouble() and written by the
+//       shortest formatter of Number.h, read back to the same bits
+// decode  numbers of a tree read with Value::asDouble() and asInt64(),
+//       compared with strtod and strtoll, halfway cases included
+//
+//   checks [part]...
+//
+// With no part, every part is checked. Each check that fails is printed
+// with what was expected; the exit status is 1 if any failed.
+#include "Lazy.h"
+#include "Parser.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+
+static int failures = 0;
+
+// Count and report a failed check
+static void
+expect(bool ok, const char* part, const char* what)
+{
+  if (ok)
+    return;
+  printf("%s: falhou: %s\n", part, what);
+  failures++;
+}
+
+// Input holding a copy of text
+static InputPtr
+inputOf(const char* text)
+{
+  std::string s(text);
+
+  return new Input(s);
+}
+
+// Whether reading the value with get throws a ParseError
+template <typename Get>
+static bool
+throws(Get get)
+{
+  try
+  {
+    get();
+  }
+  catch (const ParseError&)
+  {
+    return true;
+  }
+  return false;
+}
+
+static void
+checkLazy()
+{
+  const char* part = "lazy";
+  LazyDocument document(inputOf(
+    "{\"a\": 1, \"b\": [10, -20.5, \"x\\u00e9\\n\", true, null],"
+    " \"c\\u0064\": {\"e\": -3}, \"big\": 1e308, \"neg\": -0.0,"
+    " \"u\": 18446744073709551615}"));
+  LazyValue root = document.getRoot();
+  LazyValue b = root.get("b");
+
+  expect(root.isObject() && root.size() == 6, part, "objeto de 6 membros");
+  expect(root.get("a").asInt64() == 1, part, "get(\"a\") == 1");
+  expect(!root.get("z").isValid(), part, "get de uma chave ausente");
+  expect(b.isArray() && b.size() == 5, part, "array de 5 elementos");
+  expect(b[0].asInt64() == 10, part, "b[0] == 10");
+  expect(b[1].asDouble() == -20.5, part, "b[1] == -20.5");
+  expect(b[1].asInt64() == 0, part, "asInt64 de um double");
+  expect(b[2].getString() == "x\xc3\xa9\n", part, "getString desfaz os escapes");
+  expect(b[2].getRaw() == "x\\u00e9\\n", part, "getRaw mantem os escapes");
+  expect(b[3].getBool() && b[4].isNull(), part, "true e null");
+  expect(!b[5].isValid() && !b[-1].isValid(), part, "indice fora do array");
+  expect(b[2].getNext().getBool(), part, "getNext do elemento 2");
+  expect(!b[4].getNext().isValid(), part, "getNext do ultimo elemento");
+  expect(root.get("cd").get("e").asInt64() == -3, part, "get de chave com escape");
+  expect(root.get("b").getKey() == "b", part, "getKey");
+  expect(root.get("big").asDouble() == 1e308, part, "1e308");
+
+  double neg = root.get("neg").asDouble();
+
+  expect(neg == 0 && signbit(neg), part, "-0.0 com sinal");
+  expect(root.get("u").asUInt64() == UINT64_MAX, part, "asUInt64 do maior inteiro");
+  expect(root.get("u").asInt64() == 0, part, "asInt64 fora do intervalo");
+  expect(!root.get("a").get("x").isValid() && !root.get("a")[0].isValid(), part,
+    "get e [] de um escalar");
+
+  // Brackets that do not match are found when the document is built
+  expect(throws([] { LazyDocument d(inputOf("[1, {2]")); }), part, "colchetes trocados");
+  expect(throws([] { LazyDocument d(inputOf("[1, 2")); }), part, "array aberto");
+  expect(throws([] { LazyDocument d(inputOf("[1] 2")); }), part, "conteudo apos o documento");
+  expect(throws([] { LazyDocument d(inputOf("")); }), part, "entrada vazia");
+
+  // Anything else only when it is read
+  LazyDocument bad(inputOf("[1, 2x, \"a\\qb\", tru, 3 4, {\"k\" 5}]"));
+  LazyValue v = bad.getRoot();
+
+  expect(v[0].asInt64() == 1, part, "valor correto antes dos errados");
+  expect(throws([&] { v[1].asInt64(); }), part, "numero invalido");
+  expect(throws([&] { v[2].getString(); }), part, "escape invalido");
+  expect(throws([&] { v[3].getBool(); }), part, "literal invalido");
+  expect(throws([&] { v[5]; }), part, "virgula ausente");
+  expect(throws([&] { v.size(); }), part, "size passa pelo erro");
+
+  LazyDocument member(inputOf("{\"k\" 5}"));
+
+  expect(throws([&] { member.getRoot().getFirst(); }), part, "dois-pontos ausente");
+}
+
+static void
+checkTape()
+{
+  const char* part = "tape";
+  Parser parser;
+  TapePtr tape = parser.parseTape(inputOf(
+    "{\"a\": [1, \"x\\u00e9\", true, false, null], \"b\\u0063\": {\"d\": 2},"
+    " \"e\": \"f\"}"));
+  TapeRef root = tape->getRoot();
+  TapeRef a = root.get("a");
+
+  expect(root.isObject() && root.size() == 3, part, "objeto de 3 membros");
+  expect(a.isArray() && a.size() == 5, part, "array de 5 elementos");
+  expect(a[0].isNumber() && a[0].getText() == "1", part, "a[0] == 1");
+  expect(a[1].isString() && a[1].getText() == "x\\u00e9", part, "string com escapes");
+  expect(a[2].getBool() && !a[3].getBool() && a[4].isNull(), part, "true, false e null");
+  expect(root.get("bc").get("d").getText() == "2", part, "get de chave com escape");
+  expect(root.get("e").getText() == "f", part, "get do ultimo membro");
+
+  // Every lookup on an invalid reference gives another one
+  TapeRef none = root.get("z");
+
+  expect(!none.isValid() && !a[5].isValid() && !a[-1].isValid(), part,
+    "chave ausente e indice fora do array");
+  expect(none.size() == 0 && none.getText().empty() && !none.getBool() && !none.isNull(),
+    part, "valor de uma referencia invalida");
+  expect(!none.get("a").isValid() && !none[0].isValid() && !none.get("y")[3].get("x").isValid(),
+    part, "busca a partir de uma referencia invalida");
+  expect(!root.get("e")[0].isValid() && !a[0].get("a").isValid() && a[0].size() == 0,
+    part, "busca em um escalar");
+
+  // An array whose count is capped: it is counted, and its last elements
+  // reached, by walking it
+  const int n = Tape::MAX_COUNT + 2;
+  std::string text("[");
+
+  text.reserve(2 * n + 1);
+  for (int i = 1; i < n; i++)
+    text += "0,";
+  text += "7]";
+  tape = parser.parseTape(inputOf(text.c_str()));
+  root = tape->getRoot();
+  expect(root.size() == n, part, "array alem do limite da contagem");
+  expect(root[n - 1].getText() == "7" && !root[n].isValid(), part,
+    "ultimo elemento de um array alem do limite");
+
+  // An object built with a capped count, to walk its members
+  Tape built;
+  size_t begin = built.append(Tape::ROOT);
+  size_t object = built.append(Tape::START_OBJECT);
+
+  for (const char* key : {"x", "y", "z"})
+  {
+    built.appendString(Tape::STRING, key);
+    built.append(Tape::TRUE);
+  }
+  built.closeContainer(object, Tape::END_OBJECT, Tape::MAX_COUNT);
+  built.closeContainer(begin, Tape::ROOT, 1);
+  expect(built.getRoot().size() == 3 && built.getRoot().get("z").getBool(), part,
+    "objeto com a contagem no limite");
+}
+
+// Significant digits of a number written in JSON syntax
+static int
+digitsOf(const char* text)
+{
+  int first = -1, last = -1, n = 0;
+
+  for (const char* p = text; *p != 0 && *p != 'e'; p++)
+    if (*p >= '0' && *p <= '9')
+    {
+      if (*p != '0')
+      {
+        if (first < 0)
+          first = n;
+        last = n;
+      }
+      n++;
+    }
+  return first < 0 ? 1 : last - first + 1;
+}
+
+// Fewest significant digits that read back as v, found with printf
+static int
+shortestDigits(double v)
+{
+  char text[64];
+
+  for (int n = 1; n < 17; n++)
+  {
+    snprintf(text, sizeof(text), "%.*e", n - 1, v);
+    if (strtod(text, 0) == v)
+      return n;
+  }
+  return 17;
+}
+
+// Write v through a tree value and read it back, with strtod and with
+// the parser's own conversion: the same bits, in JSON syntax, and no
+// more digits than needed unless v is an integer written in full
+static bool
+roundTrip(double v)
+{
+  Value value;
+  char text[Number::MAX_LENGTH + 1];
+
+  value.setDouble(v);
+  text[value.formatNumber(text)] = 0;
+
+  Number::Bits bits;
+  double back = strtod(text, 0);
+  bool exact = v == floor(v) && fabs(v) < 9007199254740992.0;
+
+  if (!Number::isValid(text) || Number::decode(text, bits) != Number::DOUBLE)
+    return false;
+  if (memcmp(&back, &v, sizeof(v)) != 0 || memcmp(&bits.d, &v, sizeof(v)) != 0)
+    return false;
+  return exact || digitsOf(text) == shortestDigits(v);
+}
+
+static void
+checkFormat()
+{
+  const char* part = "format";
+  static const double values[] =
+  {
+    0.0, -0.0, 1.0, -1.0, 0.1, 0.2, 0.3, 1.0 / 3, 2.0 / 3, 1e-7, 123456.789,
+    9007199254740991.0, // 2^53 - 1
+    9007199254740992.0, // 2^53
+    9007199254740994.0, // 2^53 + 2; 2^53 + 1 has no double
+    -9007199254740993.0,
+    DBL_MAX, -DBL_MAX, DBL_MIN, DBL_EPSILON,
+    4.9406564584124654e-324, // the smallest subnormal
+    9.8813129168249309e-324,
+    1.4821969375237396e-323,
+    2.2250738585072009e-308, // the largest subnormal
+    1e-310, 5e-320,
+    1.7976931348623157e308, 8.98846567431158e307,
+    5e-324 * 3, 2.2250738585072014e-308 / 3,
+    0.30000000000000004, 1e23, 9.999999999999999e22, 5e22
+  };
+  char what[128];
+
+  for (double v : values)
+  {
+    snprintf(what, sizeof(what), "%.17g", v);
+    expect(roundTrip(v), part, what);
+  }
+
+  // Every power of ten, and its neighbours
+  for (int k = -323; k <= 308; k++)
+  {
+    char text[16];
+
+    snprintf(text, sizeof(text), "1e%d", k);
+
+    double v = strtod(text, 0);
+
+    snprintf(what, sizeof(what), "%s e vizinhos", text);
+    expect(roundTrip(v) && roundTrip(nextafter(v, 0)) && roundTrip(nextafter(v, DBL_MAX)),
+      part, what);
+  }
+
+  // Random bit patterns, subnormals among them
+  uint64_t state = 42;
+  int failed = 0;
+
+  for (int i = 0; i < 100000; i++)
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    uint64_t bits = state * 0x2545f4914f6cdd1dULL;
+    double v;
+
+    if (i % 4 == 0)
+      bits &= (1ULL << 52) - 1; // a subnormal
+    memcpy(&v, &bits, sizeof(v));
+    if (isfinite(v) && !roundTrip(v) && failed++ < 10)
+    {
+      snprintf(what, sizeof(what), "%.17g (bits %016llx)", v, (unsigned long long)bits);
+      expect(false, part, what);
+    }
+  }
+}
+
+// xorshift64*, as in corpus.cpp
+static uint64_t
+nextRandom(uint64_t& state)
+{
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dULL;
+}
+
+// Append to text a double with the bits given, written in full, and,
+// where long double holds it, the exact midpoint between it and the
+// next double, that midpoint cut short and that midpoint with a digit
+// added: the cases the fast paths of the conversion leave to the slow
+// one
+static void
+appendHard(std::string& text, uint64_t bits)
+{
+  double v;
+  char number[1200];
+
+  memcpy(&v, &bits, sizeof(v));
+  if (!isfinite(v) || v == DBL_MAX)
+    return;
+  snprintf(number, sizeof(number), ",%.17g", v);
+  text += number;
+#if LDBL_MANT_DIG >= 64
+  long double half = ((long double)v + nextafter(v, INFINITY)) / 2;
+  snprintf(number, sizeof(number), ",%.800Le", half);
+
+  char* e = strchr(number, 'e');
+  char* last = e;
+
+  while (last[-1] == '0')
+    --last;
+
+  std::string digits(number, last - number);
+  std::string exponent(e);
+
+  text += digits + exponent;
+  if (digits.size() > 24)
+    text += digits.substr(0, 24) + exponent;
+  text += digits + "1" + exponent;
+#endif
+}
+
+static void
+checkDecode()
+{
+  const char* part = "decode";
+  static const char* const numbers[] =
+  {
+    "0", "-0", "0.0", "-0.0", "0e10", "-0e-10", "1", "-1", "1.5", "1e22", "1e23",
+    "123456789e-22", "9007199254740993", "9007199254740993.0", "-9007199254740993e0",
+    "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+    "-9223372036854775809", "18446744073709551615", "18446744073709551616",
+    "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308",
+    "1e308", "9.9999999999999999e307", "1e309", "-1e309",
+    "2.2250738585072011e-308", "2.2250738585072012e-308",
+    "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324",
+    "1e-400", "0.1e-323", "100000000000000000000000000000000000000001e-40",
+    "7.2057594037927933e16", "0.30000000000000004", "3.0e-1",
+    "1.00000000000000011102230246251565404236316680908203125",
+    "1.00000000000000011102230246251565404236316680908203124",
+    "1.00000000000000011102230246251565404236316680908203126"
+  };
+  std::string text("[0");
+  uint64_t state = 7;
+
+  for (const char* n : numbers)
+    (text += ",") += n;
+  for (int i = 0; i < 5000; i++)
+  {
+    uint64_t bits = nextRandom(state);
+
+    appendHard(text, i % 8 == 0 ? bits & ((1ULL << 52) - 1) : bits);
+  }
+  for (int i = 0; i < 5000; i++)
+  {
+    char number[32];
+
+    snprintf(number, sizeof(number), ",%lld", (long long)nextRandom(state) >> (i % 64));
+    text += number;
+  }
+  text += "]";
+
+  Parser parser;
+  JsonPtr json = parser.parse(inputOf(text.c_str()));
+  const Elements* e = json->v->a->e;
+  int failed = 0;
+
+  for (int i = 0; i < e->size(); i++)
+  {
+    const Value* v = (*e)[i];
+    std::string lexeme(v->lexeme);
+    double expected = strtod(lexeme.c_str(), 0);
+    bool ok = true;
+
+    // Twice, the second time from the cache
+    for (int k = 0; k < 2; k++)
+    {
+      double d = v->asDouble();
+
+      ok &= memcmp(&d, &expected, sizeof(d)) == 0;
+    }
+
+    // An integer in range is one, but -0, which is a double
+    if (lexeme.find_first_of(".eE") == std::string::npos && lexeme != "-0")
+    {
+      errno = 0;
+
+      long long i64 = strtoll(lexeme.c_str(), 0, 10);
+
+      if (errno == 0)
+        ok &= v->isInt64() && v->asInt64() == i64;
+      else
+      {
+        errno = 0;
+
+        unsigned long long u64 = strtoull(lexeme.c_str(), 0, 10);
+
+        if (lexeme[0] != '-' && errno == 0)
+          ok &= !v->isInt64() && v->isUInt64() && v->asUInt64() == u64;
+        else
+          ok &= !v->isInt64() && !v->isUInt64() && v->asInt64() == 0;
+      }
+    }
+    else
+      ok &= !v->isInt64() && v->asInt64() == 0;
+    if (!ok && failed++ < 10)
+      expect(false, part, lexeme.substr(0, 100).c_str());
+  }
+  expect(e->size() > 10000, part, "corpus de numeros");
+}
+
+int
+main(int argc, char** argv)
+{
+  static const struct
+  {
+    const char* name;
+    void (*check)();
+  } parts[] =
+  {
+    {"lazy", checkLazy},
+    {"tape", checkTape},
+    {"format", checkFormat},
+    {"decode", checkDecode}
+  };
+  static const int NUMBER_OF_PARTS = sizeof(parts) / sizeof(parts[0]);
+
+  for (int i = 0; i < NUMBER_OF_PARTS; i++)
+  {
+    bool wanted = argc == 1;
+
+    for (int j = 1; j < argc; j++)
+      wanted |= strcmp(argv[j], parts[i].name) == 0;
+    if (wanted)
+      parts[i].check();
+  }
+  if (failures == 0)
+    printf("%s: ok\n", Cpu::getName(Cpu::level));
+  return failures != 0;
+}
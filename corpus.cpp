@@ -0,0 +1,479 @@
+// Generates the benchmark corpus: one JSON document of a given shape and
+// about a given size, written to the standard output. The same shape,
+// size and seed always give the same bytes, so results measured on
+// different commits or machines are measured on the same input.
+//
+//   corpus <shape> <size>[K|M|G] [seed]
+//
+// numbers  rows of integers and doubles, with and without exponents
+// strings  strings of words, some with escapes or non-ASCII text
+// nested   chains of objects and arrays hundreds of levels deep
+// wide     one object with a member per line
+// array    one flat array of small scalars
+// records  NDJSON records, a quarter of them damaged by a control
+//          character, a stray quote or backslash, a byte that is not
+//          UTF-8, or an early end; for make check, which compares the
+//          errors every set of vector kernels finds in them
+// escapes  strings and keys full of escapes of every kind and of text
+//          that is not ASCII; for make check, which compares how every
+//          set of kernels writes them canonically
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// xorshift64*: the same sequence on every platform, unlike rand()
+class Random
+{
+public:
+  Random(uint64_t seed):
+    state(seed != 0 ? seed : 1)
+  {
+    // do nothing
+  }
+
+  uint64_t next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+  }
+
+  // Uniform in [0, n)
+  uint32_t below(uint32_t n)
+  {
+    return (uint32_t)((next() >> 32) * n >> 32);
+  }
+
+private:
+  uint64_t state;
+
+}; // Random
+
+class Generator
+{
+public:
+  Generator(uint64_t size, uint64_t seed):
+    size(size),
+    written(0),
+    random(seed),
+    holding(false),
+    length(0)
+  {
+    // do nothing
+  }
+
+  void numbers();
+  void strings();
+  void nested();
+  void wide();
+  void array();
+  void records();
+  void escapes();
+
+private:
+  uint64_t size; // bytes wanted
+  uint64_t written;
+  Random random;
+  bool holding; // put() adds to record instead of writing
+  char record[8192];
+  size_t length; // of record
+
+  bool full() const
+  {
+    return written >= size;
+  }
+
+  void put(const char* s, size_t n)
+  {
+    if (holding)
+    {
+      memcpy(record + length, s, n);
+      length += n;
+    }
+    else
+      fwrite(s, 1, n, stdout);
+    written += n;
+  }
+
+  void put(const char* s)
+  {
+    put(s, strlen(s));
+  }
+
+  void put(char c)
+  {
+    put(&c, 1);
+  }
+
+  void number();
+  void string(int);
+  void scalar();
+  void damage();
+  void escaped();
+
+}; // Generator
+
+static const char* const words[] =
+{
+  "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+  "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+  "et", "dolore", "magna", "aliqua", "request", "server", "timeout",
+  "user", "session", "cache", "miss", "ok", "error", "retry", "payload"
+};
+static const int NUMBER_OF_WORDS = sizeof(words) / sizeof(words[0]);
+
+// An integer, a short or a long double, or one with an exponent
+void
+Generator::number()
+{
+  char text[64];
+  int n = 0;
+
+  switch (random.below(4))
+  {
+    case 0:
+      n = snprintf(text, sizeof(text), "%d", (int)random.below(2000000) - 1000000);
+      break;
+    case 1:
+      n = snprintf(text, sizeof(text), "%d.%02u", (int)random.below(20000) - 10000,
+        random.below(100));
+      break;
+    case 2:
+      n = snprintf(text, sizeof(text), "%.17g", (double)random.next() / UINT64_MAX);
+      break;
+    case 3:
+      n = snprintf(text, sizeof(text), "%u.%ue%d", random.below(10), random.below(1000000),
+        (int)random.below(600) - 300);
+      break;
+  }
+  put(text, n);
+}
+
+// A string of up to most words
+void
+Generator::string(int most)
+{
+  put('"');
+  for (int i = random.below(most) + 1; i > 0; i--)
+  {
+    put(words[random.below(NUMBER_OF_WORDS)]);
+    switch (random.below(16))
+    {
+      case 0:
+        put("\\n", 2);
+        break;
+      case 1:
+        put("\\\"", 2);
+        break;
+      case 2:
+        put("\\u00e9", 6);
+        break;
+      case 3:
+        put("\xc3\xa7\xc3\xa3o", 5); // "ção"
+        break;
+      default:
+        if (i > 1)
+          put(' ');
+    }
+  }
+  put('"');
+}
+
+void
+Generator::scalar()
+{
+  switch (random.below(5))
+  {
+    case 0:
+      put("true", 4);
+      break;
+    case 1:
+      put("null", 4);
+      break;
+    case 2:
+      string(2);
+      break;
+    default:
+      number();
+  }
+}
+
+void
+Generator::numbers()
+{
+  put("[\n", 2);
+  for (bool first = true; first || !full(); first = false)
+  {
+    if (!first)
+      put(",\n", 2);
+    put('[');
+    for (int i = 0; i < 10; i++)
+    {
+      if (i > 0)
+        put(',');
+      number();
+    }
+    put(']');
+  }
+  put("\n]\n", 3);
+}
+
+void
+Generator::strings()
+{
+  put("[\n", 2);
+  for (bool first = true; first || !full(); first = false)
+  {
+    if (!first)
+      put(",\n", 2);
+    string(random.below(8) == 0 ? 200 : 12);
+  }
+  put("\n]\n", 3);
+}
+
+// Chains of up to 500 levels, within the parser's default depth limit
+void
+Generator::nested()
+{
+  put('[');
+  for (bool first = true; first || !full(); first = false)
+  {
+    int depth = random.below(500) + 1;
+    char close[500];
+
+    if (!first)
+      put(',');
+    for (int i = 0; i < depth; i++)
+      if (random.below(2) == 0)
+      {
+        put("{\"v\":", 5);
+        close[i] = '}';
+      }
+      else
+      {
+        put('[');
+        close[i] = ']';
+      }
+    scalar();
+    while (depth > 0)
+      put(close[--depth]);
+  }
+  put("]\n", 2);
+}
+
+void
+Generator::wide()
+{
+  char key[32];
+
+  put("{\n", 2);
+  for (uint64_t i = 0; i == 0 || !full(); i++)
+  {
+    if (i > 0)
+      put(",\n", 2);
+    put(key, snprintf(key, sizeof(key), "  \"key%llu\": ", (unsigned long long)i));
+    scalar();
+  }
+  put("\n}\n", 3);
+}
+
+void
+Generator::array()
+{
+  put('[');
+  for (bool first = true; first || !full(); first = false)
+  {
+    if (!first)
+      put(',');
+    switch (random.below(8))
+    {
+      case 0:
+        put("true", 4);
+        break;
+      case 1:
+        put("false", 5);
+        break;
+      case 2:
+        put("null", 4);
+        break;
+      case 3:
+        string(1);
+        break;
+      default:
+      {
+        char text[16];
+
+        put(text, snprintf(text, sizeof(text), "%u", random.below(1000000)));
+      }
+    }
+  }
+  put("]\n", 2);
+}
+
+// One object per line, with a string long enough to span several
+// blocks of the vector kernels now and then
+void
+Generator::records()
+{
+  char text[64];
+
+  for (uint64_t i = 0; i == 0 || !full(); i++)
+  {
+    holding = true;
+    length = 0;
+    put(text, snprintf(text, sizeof(text), "{\"id\": %llu, \"name\": ",
+      (unsigned long long)i));
+    string(random.below(4) == 0 ? 200 : 6);
+    put(", \"tags\": [");
+    for (int j = random.below(4); j > 0; j--)
+    {
+      scalar();
+      if (j > 1)
+        put(", ", 2);
+    }
+    put("], \"v\": {\"x\": ");
+    number();
+    put("}}", 2);
+    if (random.below(4) == 0)
+      damage();
+    holding = false;
+    fwrite(record, 1, length, stdout);
+    put('\n');
+  }
+}
+
+// Make the record invalid at a random byte of it
+void
+Generator::damage()
+{
+  static const char* const bytes[] =
+  {
+    "\x01", // a control character
+    "\"",
+    "\\",
+    "\x80", // a continuation byte with no lead
+    "\xc0", // a lead byte of an overlong encoding
+    "\xe3", // a lead byte whose sequence is cut short
+    "\xf5", // a byte above the last code point
+    "\xed\xa0\x80" // a surrogate
+  };
+  size_t at = random.below(length);
+  int kind = random.below(9);
+
+  if (kind == 8)
+  {
+    length = at;
+    return;
+  }
+
+  size_t n = strlen(bytes[kind]);
+
+  if (at + n > length)
+    at = length - n;
+  memcpy(record + at, bytes[kind], n);
+}
+
+// A string of escapes and of characters that are not ASCII, between
+// runs of letters of any length, so that they fall anywhere in a block
+void
+Generator::escaped()
+{
+  static const char* const pieces[] =
+  {
+    "\\b", "\\f", "\\n", "\\r", "\\t", "\\\"", "\\\\", "\\/",
+    "\\u0001", "\\u001f", "\\u007f", "\\u00e9", "\\u20ac", "\\ud83d\\ude00",
+    "\xc3\xa7", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\x7f", "'", "<"
+  };
+  static const int NUMBER_OF_PIECES = sizeof(pieces) / sizeof(pieces[0]);
+
+  put('"');
+  for (int i = random.below(8); i >= 0; i--)
+  {
+    for (int j = random.below(71); j > 0; j--)
+      put((char)('a' + random.below(26)));
+    put(pieces[random.below(NUMBER_OF_PIECES)]);
+  }
+  put('"');
+}
+
+void
+Generator::escapes()
+{
+  put("[\n", 2);
+  for (bool first = true; first || !full(); first = false)
+  {
+    if (!first)
+      put(",\n", 2);
+    if (random.below(4) == 0)
+    {
+      put('{');
+      escaped();
+      put(": ", 2);
+      escaped();
+      put('}');
+    }
+    else
+      escaped();
+  }
+  put("\n]\n", 3);
+}
+
+// Size with an optional K, M or G suffix
+static uint64_t
+parseSize(const char* s)
+{
+  char* end;
+  uint64_t n = strtoull(s, &end, 10);
+
+  switch (*end)
+  {
+    case 'k':
+    case 'K':
+      return n << 10;
+    case 'm':
+    case 'M':
+      return n << 20;
+    case 'g':
+    case 'G':
+      return n << 30;
+  }
+  return n;
+}
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "uso: corpus numbers|strings|nested|wide|array|records|escapes tamanho[K|M|G] [semente]\n");
+    return 1;
+  }
+
+  static char buffer[1 << 20];
+  Generator g(parseSize(argv[2]), argc > 3 ? strtoull(argv[3], 0, 10) : 42);
+  const char* shape = argv[1];
+
+  setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+  if (strcmp(shape, "numbers") == 0)
+    g.numbers();
+  else if (strcmp(shape, "strings") == 0)
+    g.strings();
+  else if (strcmp(shape, "nested") == 0)
+    g.nested();
+  else if (strcmp(shape, "wide") == 0)
+    g.wide();
+  else if (strcmp(shape, "array") == 0)
+    g.array();
+  else if (strcmp(shape, "records") == 0)
+    g.records();
+  else if (strcmp(shape, "escapes") == 0)
+    g.escapes();
+  else
+  {
+    fprintf(stderr, "forma desconhecida: %s\n", shape);
+    return 1;
+  }
+  return 0;
+}
@@ -1,23 +1,42 @@
-#include "jr.h"
-#include<iostream>
-#include<fstream>
-using namespace std;
-
-int main(int argc,char *argv[])
-{
-  fstream f(argv[1], fstream::in );
-  string text;
-  if(f.good()){
-      //Pegar conteudo do arquivo
-      getline( f, text, '\0');
-      f.close();
-      const char * textc = text.c_str();
-
-      Parser parser;
-      parser.parse(textc);
-  }
-  else
-    printf("O arquivo não existe.\n");
-  return 0;
-}
-
+#include "jr.h"
+using namespace std;
+
+int main(int argc,char *argv[])
+{
+  // --stats, --stats=json: statistics on the standard error at the end
+  // --profile, --profile=json: the statistics with hardware counters (make STATS=1)
+  int stats = 0;
+  int arg = 1;
+  if(argc > 1 && (strncmp(argv[1], "--stats", 7) == 0 || strncmp(argv[1], "--profile", 9) == 0)){
+    if(argv[1][2] == 'p' && !Stats::enabled()){
+      fprintf(stderr, "--profile requer os contadores: compile com make STATS=1\n");
+      return 1;
+    }
+    stats = strstr(argv[1], "=json") != 0 ? 2 : 1;
+    Stats::setProfiling(argv[1][2] == 'p');
+    arg = 2;
+  }
+  if(argc <= arg){
+    printf("Está faltando argumentos!\n");
+    return 0;
+  }
+  //Mapear o arquivo ("-" le a entrada padrao)
+  InputPtr input = Input::load(argv[arg]);
+  if(input != 0){
+      Parser parser;
+      try{
+        parser.parse(input);
+      }
+      catch(const ParseError& e){
+        printf("**Error (%d): %s na coluna %d (byte %zu)\n", e.lineNumber, e.getMessage(), e.column, e.offset);
+        return 1;
+      }
+      if(stats != 0){
+        fflush(stdout);
+        Stats::total().write(stderr, stats == 2);
+      }
+  }
+  else
+    printf("O arquivo não existe.\n");
+  return 0;
+}
@@ -1,29 +1,190 @@
-#include "Parser.h"
-#include "Writer.h"
-#include<iostream>
-#include<fstream>
-
-using namespace std;
-
-int main(int argc, char** argv)
-{
-    if(argc==1){
-	printf("Está faltando argumentos!\n");
-	return 0;
-    }
-    fstream f(argv[1], fstream::in);
-    string text;
-    if(f.good()){
-        //Pegar conteudo do arquivo
-        getline(f, text, '\0');
-        f.close();
-        const char *textc = text.c_str();
-        Parser parser;
-        Json* J = parser.parse(textc);
-        Writer writer;
-        J->write(writer);
-    }
-    else
-        printf("O arquivo não existe.\n");
-    return 0;
-}
+#include "Parser.h"
+#include "PushParser.h"
+#include "Ndjson.h"
+#include "Parallel.h"
+#include "Serializer.h"
+#include "Writer.h"
+#include<string.h>
+#include<fcntl.h>
+#include<unistd.h>
+
+using namespace std;
+
+// Writes the statistics of the whole run when main returns
+class StatsReport
+{
+public:
+    enum { NONE, TEXT, JSON } format;
+    StatsReport()
+    {
+        format = NONE;
+    }
+    ~StatsReport()
+    {
+        if(format != NONE){
+            fflush(stdout);
+            Stats::total().write(stderr, format == JSON);
+        }
+    }
+};
+
+void report(const ParseError& e)
+{
+    printf("**Error (%d): %s na coluna %d (byte %zu)\n", e.lineNumber, e.getMessage(), e.column, e.offset);
+}
+
+// Parse a file or pipe as it is read, one block at a time; false if it
+// cannot be opened
+bool push(const char* fileName, ParseResult& result)
+{
+    int fd = strcmp(fileName, "-") == 0 ? 0 : open(fileName, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    PushParser parser;
+    parser.setValidateUtf8(true);
+    char block[64 * 1024];
+    ssize_t n;
+    int status = PushParser::NEED_MORE;
+    while(status != PushParser::ERROR && (n = read(fd, block, sizeof(block))) > 0)
+        status = parser.feed(block, n);
+    if(fd != 0)
+        close(fd);
+    parser.finish();
+    parser.getResult(result);
+    return true;
+}
+
+// Writes the records of an NDJSON input in order
+class RecordWriter
+{
+public:
+    Writer writer;
+    int errors;
+    RecordWriter()
+    {
+        errors = 0;
+    }
+    void record(const Ndjson::Record& r)
+    {
+        Stats::Timer timer(Stats::WRITE);
+        if(r.json != 0){
+            r.json->write(writer);
+            writer.tab(); // Json::write leaves the level one block out
+        }
+        else{
+            ParseError e = r.error;
+            e.lineNumber = r.lineNumber;
+            writer.flush(); // keep the records in order
+            report(e);
+            errors++;
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    // --tape: build the flat tape instead of the tree
+    // --push: parse the input block by block as it is read
+    // --ndjson: one document per line, parsed by a pool of threads
+    // --parallel: split a large array or object among threads
+    // --json, --pretty: write the document as compact or indented JSON
+    // --canonical: compact JSON, with the strings unescaped and escaped again
+    // --stats, --stats=json: statistics on the standard error at the end
+    // --profile, --profile=json: the statistics with hardware counters (make STATS=1)
+    StatsReport stats;
+    const char* mode = "";
+    int arg = 1;
+    for(; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+        if(strncmp(argv[arg], "--stats", 7) == 0 || strncmp(argv[arg], "--profile", 9) == 0){
+            if(argv[arg][2] == 'p'){
+                if(!Stats::enabled()){
+                    fprintf(stderr, "--profile requer os contadores: compile com make STATS=1\n");
+                    return 1;
+                }
+                Stats::setProfiling(true);
+            }
+            stats.format = strstr(argv[arg], "=json") != 0 ? StatsReport::JSON : StatsReport::TEXT;
+        }
+        else
+            mode = argv[arg];
+    bool tape = strcmp(mode, "--tape") == 0;
+    bool stream = strcmp(mode, "--push") == 0;
+    bool lines = strcmp(mode, "--ndjson") == 0;
+    bool parallel = strcmp(mode, "--parallel") == 0;
+    bool json = strcmp(mode, "--json") == 0;
+    bool pretty = strcmp(mode, "--pretty") == 0;
+    bool canonical = strcmp(mode, "--canonical") == 0;
+
+    if(argc<=arg){
+	printf("Está faltando argumentos!\n");
+	return 0;
+    }
+    if(stream){
+        ParseResult result;
+        if(!push(argv[arg], result)){
+            printf("O arquivo não existe.\n");
+            return 0;
+        }
+        if(!result.ok()){
+            report(result.error);
+            return 1;
+        }
+        Writer writer;
+        Stats::Timer timer(Stats::WRITE);
+        result.json->write(writer);
+        writer.flush();
+        return 0;
+    }
+    //Mapear o arquivo ("-" le a entrada padrao)
+    InputPtr input = Input::load(argv[arg]);
+    if(input != 0){
+        if(lines){
+            Ndjson ndjson;
+            RecordWriter records;
+            ndjson.setValidateUtf8(true);
+            ndjson.parse(input, records);
+            return records.errors != 0;
+        }
+        Parser parser;
+        Writer writer;
+        parser.setValidateUtf8(true);
+        try{
+            if(tape){
+                Tape* T = parser.parseTape(input);
+                Stats::Timer timer(Stats::WRITE);
+                T->write(writer);
+                writer.flush();
+            }
+            else if(json || pretty || canonical){
+                Json* J = parser.parse(input);
+                Stats::Timer timer(Stats::WRITE);
+                Serializer serializer(writer, pretty ? 2 : 0);
+                serializer.setCanonicalStrings(canonical);
+                serializer.write(J);
+                writer.flush();
+            }
+            else if(parallel){
+                ParallelParser threads;
+                threads.setValidateUtf8(true);
+                Json* J = threads.parse(input);
+                Stats::Timer timer(Stats::WRITE);
+                J->write(writer);
+                writer.flush();
+            }
+            else{
+                Json* J = parser.parse(input);
+                Stats::Timer timer(Stats::WRITE);
+                J->write(writer);
+                writer.flush();
+            }
+        }
+        catch(const ParseError& e){
+            report(e);
+            return 1;
+        }
+    }
+    else
+        printf("O arquivo não existe.\n");
+    return 0;
+}